@@ -0,0 +1,343 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "platform.h"
+#include "interpret.h"
+#include "scheduler.h"
+#include "quirks.h"
+#include "batch.h"
+#include "jit.h"
+
+/**
+ * Benchmarks, all headless and unthrottled. Micro benchmarks time one piece
+ * of the emulator in a loop; macro benchmarks run each ROM given on the
+ * command line under every engine, with idle skipping off so every
+ * instruction counted is one run, and then once with it on (skip_idle).
+ * Each is run REPEATS times and the fastest kept, as anything slower is
+ * noise from the rest of the machine.
+ *
+ * Usage: ./chip8-bench [--cycles N] [--csv FILE] [--compare FILE] [rom ...]
+ *
+ * --csv writes the results as `name,ns_per_op,ops_per_second`, and
+ * --compare reads such a file back to show how far each result moved.
+ **/
+
+#define REPEATS 5
+#define MICRO_NS 20000000ull // how long one run of a micro benchmark aims for.
+#define MACRO_CYCLES 2000000 // default instructions per ROM and engine.
+#define MACRO_CYCLES_PER_FRAME 10000
+#define MAX_RESULTS 256
+#define NAME_SIZE 64
+
+struct result {
+    char name[NAME_SIZE];
+    double ns_per_op;
+};
+
+static struct result baseline[MAX_RESULTS];
+static size_t baseline_count = 0;
+static FILE* csv = NULL;
+
+static struct interpreter interpreter;
+static volatile uint64_t sink; // keeps results alive, so nothing is optimized out.
+
+static bool load_baseline(const char* filename) {
+    FILE* fp = fopen(filename, "r");
+    if(fp == NULL) {
+        fprintf(stderr, "Unable to open '%s'\n", filename);
+        return false;
+    }
+    char line[256];
+    while(baseline_count < MAX_RESULTS && fgets(line, sizeof(line), fp) != NULL) {
+        struct result* result = &baseline[baseline_count];
+        char* comma = strchr(line, ',');
+        if(comma == NULL || (size_t) (comma - line) >= NAME_SIZE) continue;
+        memcpy(result->name, line, comma - line);
+        result->name[comma - line] = '\0';
+        char* end;
+        result->ns_per_op = strtod(comma + 1, &end);
+        if(end != comma + 1) baseline_count++;
+    }
+    fclose(fp);
+    return true;
+}
+
+static void report(const char* name, double ns_per_op) {
+    printf("%-48s %10.2f ns/op %14.0f ops/s", name, ns_per_op,
+            ns_per_op > 0 ? 1e9 / ns_per_op : 0.0);
+    for(size_t i = 0; i < baseline_count; i++) {
+        if(strcmp(baseline[i].name, name) == 0 && baseline[i].ns_per_op > 0) {
+            printf(" %+7.1f%%", 100.0 * (ns_per_op - baseline[i].ns_per_op) / baseline[i].ns_per_op);
+            break;
+        }
+    }
+    printf("\n");
+    if(csv != NULL) {
+        fprintf(csv, "%s,%.3f,%.0f\n", name, ns_per_op, ns_per_op > 0 ? 1e9 / ns_per_op : 0.0);
+    }
+}
+
+static void reset_interpreter(void) {
+    memset(&interpreter, 0, sizeof(interpreter));
+    interpreter.planes = 0x01;
+    initialize_font(interpreter.memory);
+    uint8_t quirks = 0;
+    parse_quirks(DEFAULT_QUIRKS, &quirks);
+    set_quirks(&interpreter, quirks);
+    set_stack_depth(&interpreter, STACK_DEPTH);
+    seed_random(&interpreter, 1);
+    interpreter.platform = &headless_platform;
+}
+
+typedef void (*micro_body)(uint64_t iterations, const void* argument);
+
+/**
+ * Finds how many iterations take about MICRO_NS, then keeps the fastest of
+ * REPEATS runs of that many.
+ **/
+static void run_micro(const char* name, micro_body body, const void* argument) {
+    uint64_t iterations = 1;
+    for(;;) {
+        uint64_t start = monotonic_ns();
+        body(iterations, argument);
+        uint64_t elapsed = monotonic_ns() - start;
+        if(elapsed >= MICRO_NS / 4 || iterations >= (1ull << 40)) break;
+        iterations *= 2;
+    }
+    iterations *= 4;
+
+    double best = 0;
+    for(int i = 0; i < REPEATS; i++) {
+        uint64_t start = monotonic_ns();
+        body(iterations, argument);
+        double ns_per_op = (double) (monotonic_ns() - start) / iterations;
+        if(i == 0 || ns_per_op < best) best = ns_per_op;
+    }
+    report(name, best);
+}
+
+// fetches and decodes the instruction at START_ADDRESS, without running it.
+static void fetch_decode(uint64_t iterations, const void* argument) {
+    (void) argument;
+    struct operation op;
+    uint64_t handlers = 0;
+    while(iterations-- > 0) {
+        interpreter.program_counter = START_ADDRESS;
+        interpreter.decode_operation(fetch(&interpreter), &op);
+        handlers += op.handler;
+    }
+    sink = handlers;
+}
+
+struct sprite_position {
+    const char* name;
+    uint8_t x;
+    uint8_t y;
+    bool hires; // and so a 16x16 sprite, DXY0.
+};
+
+static void draw(uint64_t iterations, const void* argument) {
+    const struct sprite_position* position = argument;
+    interpreter.registers[0] = position->x;
+    interpreter.registers[1] = position->y;
+    interpreter.index_register = FONT_START_ADDRESS;
+    interpreter.display.hires = position->hires;
+    struct operation op;
+    interpreter.decode_operation(position->hires ? 0xD010 : 0xD01F, &op);
+    operation_handler handler = get_handler(op.handler);
+    while(iterations-- > 0) {
+        handler(&interpreter, &op);
+    }
+    sink = interpreter.registers[0xF];
+}
+
+// runs one instruction over and over, e.g. a scroll.
+static void run_instruction(uint64_t iterations, const void* argument) {
+    struct operation op;
+    interpreter.decode_operation(*(const uint16_t*) argument, &op);
+    operation_handler handler = get_handler(op.handler);
+    while(iterations-- > 0) {
+        handler(&interpreter, &op);
+    }
+    sink = interpreter.display.planes[0][0][0];
+}
+
+static void clear(uint64_t iterations, const void* argument) {
+    (void) argument;
+    while(iterations-- > 0) {
+        clear_display(&interpreter.display, interpreter.planes);
+        interpreter.display.planes[0][iterations & (HEIGHT - 1)][0] = iterations;
+    }
+    sink = interpreter.display.planes[0][0][0];
+}
+
+static void present(uint64_t iterations, const void* argument) {
+    (void) argument;
+    static uint32_t texels[HIRES_WIDTH * HIRES_HEIGHT];
+    int pitch = DISPLAY_WIDTH(&interpreter.display) * sizeof(texels[0]);
+    while(iterations-- > 0) {
+        expand_display(&interpreter.display, texels, pitch);
+    }
+    sink = texels[0];
+}
+
+// a checkerboard over the whole of the current resolution.
+static void fill_display(void) {
+    for(uint32_t i = 0; i < HIRES_HEIGHT; i++) {
+        for(uint32_t j = 0; j < ROW_WORDS; j++) {
+            interpreter.display.planes[0][i][j] = 0x5555555555555555ull << (i & 1);
+        }
+    }
+}
+
+static void run_micros(void) {
+    // one of each family, i.e. first nibble.
+    static const uint16_t families[16] = {
+        0x00E0, 0x1200, 0x2200, 0x3012, 0x4012, 0x5010, 0x6012, 0x7012,
+        0x8014, 0x9010, 0xA200, 0xB200, 0xC0FF, 0xD015, 0xE09E, 0xF065
+    };
+    char name[NAME_SIZE];
+    for(int i = 0; i < 16; i++) {
+        reset_interpreter();
+        interpreter.memory[START_ADDRESS] = families[i] >> 8;
+        interpreter.memory[START_ADDRESS + 1] = families[i] & 0xFF;
+        snprintf(name, sizeof(name), "micro/fetch_decode/%04X", families[i]);
+        run_micro(name, fetch_decode, NULL);
+    }
+
+    // 15 rows of font, lined up with nothing, clipped right, bottom, and both.
+    static const struct sprite_position positions[] = {
+        {"aligned", 0, 0, false},
+        {"unaligned", 13, 5, false},
+        {"clipped_right", 60, 5, false},
+        {"clipped_bottom", 13, 24, false},
+        {"clipped_corner", 60, 24, false},
+        {"hires_aligned", 0, 0, true},
+        {"hires_unaligned", 77, 21, true},
+        {"hires_clipped_corner", 120, 56, true}
+    };
+    for(size_t i = 0; i < sizeof(positions) / sizeof(positions[0]); i++) {
+        reset_interpreter();
+        snprintf(name, sizeof(name), "micro/draw_sprite/%s", positions[i].name);
+        run_micro(name, draw, &positions[i]);
+    }
+
+    reset_interpreter();
+    run_micro("micro/clear_display", clear, NULL);
+    fill_display();
+    run_micro("micro/expand_display", present, NULL);
+    interpreter.display.hires = true;
+    fill_display();
+    run_micro("micro/expand_display/hires", present, NULL);
+
+    // scrolls, in hi-res where they move the most.
+    static const struct {
+        const char* name;
+        uint16_t instruction;
+    } scrolls[] = {
+        {"down", 0x00C4},
+        {"up", 0x00D4},
+        {"right", 0x00FB},
+        {"left", 0x00FC}
+    };
+    for(size_t i = 0; i < sizeof(scrolls) / sizeof(scrolls[0]); i++) {
+        reset_interpreter();
+        interpreter.display.hires = true;
+        fill_display();
+        snprintf(name, sizeof(name), "micro/scroll/hires_%s", scrolls[i].name);
+        run_micro(name, run_instruction, &scrolls[i].instruction);
+    }
+}
+
+static void run_macro(const char* rom, uint8_t engine, const char* engine_name, uint64_t cycles,
+        bool skip_idle) {
+    double best = 0;
+    for(int i = 0; i < REPEATS; i++) {
+        if(!load_program(&interpreter, rom)) return;
+        uint8_t quirks = 0;
+        parse_quirks(DEFAULT_QUIRKS, &quirks);
+        set_quirks(&interpreter, quirks);
+        set_stack_depth(&interpreter, STACK_DEPTH);
+        seed_random(&interpreter, 1);
+        interpreter.platform = &headless_platform;
+        interpreter.engine = engine;
+        interpreter.skip_idle = skip_idle;
+        if(engine == ENGINE_JIT && (interpreter.jit = create_jit()) == NULL) return;
+
+        struct scheduler scheduler;
+        init_scheduler(&scheduler, FREQUENCY);
+        set_cycles_per_frame(&scheduler, MACRO_CYCLES_PER_FRAME);
+        uint64_t start = monotonic_ns();
+        run_headless(&interpreter, &scheduler, cycles);
+        double ns_per_op = (double) (monotonic_ns() - start) / cycles;
+        destroy_jit(interpreter.jit);
+        if(i == 0 || ns_per_op < best) best = ns_per_op;
+    }
+
+    const char* base = strrchr(rom, '/');
+    char name[NAME_SIZE];
+    snprintf(name, sizeof(name), "macro/%s/%s", engine_name, base != NULL ? base + 1 : rom);
+    report(name, best);
+}
+
+int main(int argc, char* argv[]) {
+    uint64_t cycles = MACRO_CYCLES;
+    const char* csv_name = NULL;
+    int first_rom = argc;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csv_name = argv[++i];
+        } else if(strcmp(argv[i], "--compare") == 0 && i + 1 < argc) {
+            if(!load_baseline(argv[++i])) return EXIT_FAILURE;
+        } else {
+            first_rom = i;
+            break;
+        }
+    }
+    if(cycles == 0) {
+        fprintf(stderr, "--cycles must be more than 0\n");
+        return EXIT_FAILURE;
+    }
+    if(csv_name != NULL && (csv = fopen(csv_name, "w")) == NULL) {
+        fprintf(stderr, "Unable to write '%s'\n", csv_name);
+        return EXIT_FAILURE;
+    }
+
+    run_micros();
+    static const struct {
+        uint8_t engine;
+        const char* name;
+    } engines[] = {
+        {ENGINE_INTERPRETER, "interpreter"},
+        {ENGINE_THREADED, "threaded"},
+        {ENGINE_JIT, "jit"}
+    };
+    for(int i = first_rom; i < argc; i++) {
+        for(size_t j = 0; j < sizeof(engines) / sizeof(engines[0]); j++) {
+            run_macro(argv[i], engines[j].engine, engines[j].name, cycles, false);
+        }
+        // the same, less what the program spends idling; see run_cycles().
+        run_macro(argv[i], ENGINE_INTERPRETER, "skip_idle", cycles, true);
+    }
+
+    if(csv != NULL) fclose(csv);
+    return EXIT_SUCCESS;
+}
+
+#undef NAME_SIZE
+#undef MAX_RESULTS
+#undef MACRO_CYCLES_PER_FRAME
+#undef MACRO_CYCLES
+#undef MICRO_NS
+#undef REPEATS
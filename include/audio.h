@@ -0,0 +1,44 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __AUDIO_H__
+#define __AUDIO_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "settings.h"
+#include "platform.h"
+
+#define WAVETABLE_BITS 8
+#define WAVETABLE_SIZE (1 << WAVETABLE_BITS)
+#define PATTERN_BITS 7 // a sound_pattern is 128 samples.
+
+/**
+ * The tone generator behind the audio stream. One period of whatever is
+ * playing sits in `wavetable` (a sine for the beep, or the XO-CHIP
+ * pattern), and a 32-bit phase accumulator steps through it, so making a
+ * sample is a table lookup and an add.
+ *
+ * The sound timer gates it by the sample: set_audio() turns the timer into
+ * how many samples are left to play, and render_audio() plays silence once
+ * they run out, so the stream itself never stops.
+ **/
+struct audio {
+    float wavetable[WAVETABLE_SIZE];
+    uint8_t table_bits; // log2 of how much of wavetable is one period.
+    uint32_t phase; // how far into the period, in 1/2^32ths.
+    uint32_t step; // added to phase each sample.
+    uint32_t gate; // samples left to play.
+
+    // what is in wavetable, to rebuild it only when the program changes it.
+    struct sound_pattern pattern;
+    bool has_pattern;
+};
+
+void init_audio(struct audio* audio);
+void set_audio(struct audio* audio, uint8_t timer_value, const struct sound_pattern* pattern);
+void render_audio(struct audio* audio, float* samples, uint32_t count);
+
+#endif
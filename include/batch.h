@@ -0,0 +1,54 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "interpret.h"
+#include "scheduler.h"
+
+/**
+ * Runs many ROMs headless at once, one job per line of a manifest:
+ *
+ *     <rom> <cycles> [seed] [input script]
+ *
+ * (see script.h for input scripts; '-' or nothing means no keys). Jobs are
+ * spread over a pool of threads that steal from each other when they run
+ * out, and each prints a line with the final display hash, registers, and
+ * cycle count, in manifest order.
+ *
+ * With `lockstep` set, runs of consecutive jobs with the same ROM and cycle
+ * count are run together through lockstep.h, up to LOCKSTEP_LANES at a time.
+ **/
+struct batch_options {
+    uint8_t quirks;
+    uint8_t stack_depth;
+    uint8_t engine; // an enum engine.
+    uint32_t cycles_per_frame; // 0 for the default.
+    uint32_t threads; // 0 for one per core.
+    bool lockstep;
+};
+
+// returns the number of jobs that failed, or -1 if the manifest is unusable.
+int run_batch(const char* manifest, const struct batch_options* options, FILE* out);
+
+/**
+ * Runs a manifest whose lines each start with the display hash the job
+ * should end with, and prints the ones that don't.
+ * @return  the number of jobs that failed or didn't match, or -1 if the file is unusable
+ **/
+int check_golden(const char* golden, const struct batch_options* options, FILE* out);
+
+/**
+ * Runs frames as fast as the host allows, batched exactly as on screen,
+ * so the program sees the same timing it would see on screen.
+ * @param   cycles  how many instructions to run, or 0 to run until the platform quits
+ **/
+void run_headless(struct interpreter* interpreter, struct scheduler* scheduler, uint64_t cycles);
+
+#endif
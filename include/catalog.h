@@ -0,0 +1,43 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __CATALOG_H__
+#define __CATALOG_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define CATALOG_NAME_SIZE 64
+
+/**
+ * The catalog is a text file of ROMs known to need settings of their own,
+ * one per line, found by the hash of the ROM file (see load_program()):
+ *
+ *     <hash> <quirks> <cycles per frame> <keymap> [name]
+ *
+ * The hash is 16 hex digits. Quirks are as for --quirks, and the keymap is
+ * 16 hex digits, the CHIP-8 key played by each of the keys 0 to F on the
+ * keyboard (so 0123456789ABCDEF changes nothing). '-' leaves any of them
+ * as they are. Lines starting with '#' are comments.
+ *
+ * The file is mapped and only lines starting with the hash wanted are
+ * parsed, so a catalog of thousands of ROMs takes well under a millisecond.
+ **/
+struct catalog_entry {
+    bool has_quirks;
+    uint8_t quirks;
+    uint32_t cycles_per_frame; // 0 for the default.
+    bool has_keymap;
+    uint8_t keymap[16];
+    char name[CATALOG_NAME_SIZE]; // empty if not given.
+};
+
+/**
+ * Looks `hash` up in the catalog `filename`.
+ * @param   required    whether a missing file is a failure, rather than an empty catalog
+ * @return  1 if found, 0 if not, or -1 if the catalog is unusable
+ **/
+int find_in_catalog(const char* filename, uint64_t hash, struct catalog_entry* entry, bool required);
+
+#endif
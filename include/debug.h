@@ -1,6 +1,7 @@
 #ifndef __DEBUG_H__
 #define __DEBUG_H__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
@@ -8,13 +9,19 @@
 #include "settings.h"
 #include "interpret.h"
 #include "memory.h"
-#include "screen.h"
+#include "platform.h"
+#include "scheduler.h"
 
 void dump_memory(FILE* fp, uint8_t* memory);
 void dump_registers(FILE* fp, uint8_t* registers);
-void dump_stack(FILE* fp, struct stack* stack);
-void dump_display(FILE* fp, bool display[][WIDTH]);
-void debugger(struct interpreter* interpreter, struct screen* screen);
+void dump_stack(FILE* fp, const uint16_t* stack, uint8_t pointer);
+void dump_display(FILE* fp, const struct display* display);
+uint64_t hash_display(const struct display* display);
+uint64_t hash_bytes(const uint8_t* bytes, size_t length);
+// carries on a hash_bytes() with more bytes, for input that comes in pieces.
+uint64_t hash_more(uint64_t hash, const uint8_t* bytes, size_t length);
+void dump_sizes(FILE* fp);
+void debugger(struct interpreter* interpreter, struct scheduler* scheduler, bool realtime);
 
 #endif
 
@@ -1,30 +1,204 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: 01/01/26
+ * Date modified: 10/17/26
  **/
 #ifndef __INTERPRET_H__
 #define __INTERPRET_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "settings.h"
 #include "memory.h"
-#include "screen.h"
+#include "platform.h"
+#include "jit.h"
+#include "latency.h"
+#include "quirks.h"
 
-struct interpreter {
-    uint8_t memory[MEMORY_SIZE];
-    bool display[HEIGHT][WIDTH];
-    struct stack stack;
-    uint8_t registers[REGISTER_SIZE];
+/**
+ * Which operation a decoded instruction performs.
+ * OP_UNDECODED is zero so that a zeroed cache starts out empty.
+ **/
+enum operation_type {
+    OP_UNDECODED = 0,
+    OP_SYSTEM,
+    OP_CLEAR,
+    OP_RETURN,
+    OP_JUMP,
+    OP_CALL,
+    OP_SKIP_EQUAL_IMMEDIATE,
+    OP_SKIP_NOT_EQUAL_IMMEDIATE,
+    OP_SKIP_EQUAL_REGISTER,
+    OP_SET_IMMEDIATE,
+    OP_ADD_IMMEDIATE,
+    OP_SET_REGISTER,
+    OP_OR,
+    OP_AND,
+    OP_XOR,
+    OP_ADD_REGISTER,
+    OP_SUBTRACT,
+    OP_SHIFT_RIGHT,
+    OP_SUBTRACT_REVERSE,
+    OP_SHIFT_LEFT,
+    OP_SKIP_NOT_EQUAL_REGISTER,
+    OP_SET_INDEX,
+    OP_JUMP_OFFSET,
+    OP_RANDOM,
+    OP_DRAW,
+    OP_SKIP_KEY,
+    OP_SKIP_NOT_KEY,
+    OP_GET_DELAY,
+    OP_WAIT_KEY,
+    OP_SET_DELAY,
+    OP_SET_SOUND,
+    OP_ADD_INDEX,
+    OP_FONT,
+    OP_DECIMAL,
+    OP_STORE,
+    OP_LOAD,
+    // variants of the above under some quirk.
+    OP_SHIFT_RIGHT_VY,
+    OP_SHIFT_LEFT_VY,
+    OP_JUMP_OFFSET_VX,
+    OP_ADD_INDEX_FLAG,
+    OP_STORE_INCREMENT,
+    OP_LOAD_INCREMENT,
+    OP_STORE_INCREMENT_X,
+    OP_LOAD_INCREMENT_X,
+    // XO-CHIP.
+    OP_AUDIO,
+    OP_PITCH,
+    // SUPER-CHIP.
+    OP_SCROLL_DOWN,
+    OP_SCROLL_RIGHT,
+    OP_SCROLL_LEFT,
+    OP_EXIT,
+    OP_LOW_RESOLUTION,
+    OP_HIGH_RESOLUTION,
+    OP_BIG_FONT,
+    OP_SAVE_FLAGS,
+    OP_LOAD_FLAGS,
+    // XO-CHIP again.
+    OP_SCROLL_UP,
+    OP_SAVE_RANGE,
+    OP_LOAD_RANGE,
+    OP_LONG_INDEX,
+    OP_PLANES,
+    OP_UNKNOWN,
+    OP_COUNT
+};
+
+/**
+ * An instruction with the operation it is already worked out. Its operands
+ * are a shift and a mask away, i.e. for 0xDXYN or 0x8XYN, OP_X() = X,
+ * OP_Y() = Y, OP_N() = N, OP_NN() = YN, OP_NNN() = XYN, which keeps each
+ * slot of the decode cache to 4 bytes.
+ **/
+struct operation {
+    uint8_t handler; // an enum operation_type.
+    uint16_t instruction;
+};
+
+#define OP_X(op) (((op)->instruction >> 8) & 0x0F)
+#define OP_Y(op) (((op)->instruction >> 4) & 0x0F)
+#define OP_N(op) ((op)->instruction & 0x0F)
+#define OP_NN(op) ((op)->instruction & 0xFF)
+#define OP_NNN(op) ((op)->instruction & 0x0FFF)
+
+/**
+ * Something the program did that the machine can't. The interpreter stays
+ * on the instruction that faulted, so the program goes no further.
+ **/
+enum fault {
+    FAULT_NONE = 0,
+    FAULT_STACK_OVERFLOW, // a call with stack_depth calls already made.
+    FAULT_STACK_UNDERFLOW, // a return with no call to return from.
+    FAULT_EXIT // 00FD, the program asked to stop.
+};
+
+// How run_cycles() executes instructions.
+enum engine {
+    ENGINE_INTERPRETER = 0,
+    ENGINE_THREADED,
+    ENGINE_JIT
+};
+
+struct profile;
+struct trace;
 
+typedef void (*operation_handler)(struct interpreter* interpreter, const struct operation* op);
+typedef void (*operation_decoder)(uint16_t instruction, struct operation* op);
+
+// One slot per two bytes of memory, i.e. per instruction at an even address.
+#define CACHE_SIZE (MEMORY_SIZE / 2)
+
+/**
+ * Laid out hottest first: what nearly every instruction touches shares the
+ * first cache line, then come the stack and display, then memory and the
+ * decode cache. `--sizes` prints what each part takes.
+ **/
+struct interpreter {
+    _Alignas(64) uint8_t registers[REGISTER_SIZE];
     uint16_t program_counter;
     uint16_t index_register;
     uint8_t delay_timer;
     uint8_t sound_timer;
+    uint8_t stack_pointer; // calls made, i.e. the next free entry in stack.
+    uint8_t stack_depth; // calls allowed, at most STACK_MAX_DEPTH.
+    uint8_t engine; // an enum engine.
+    uint8_t fault; // an enum fault.
+    uint16_t dirty_pages; // bit i set when memory page i was written since the last snapshot.
+    uint16_t keys; // the keypad as of this frame, see poll_platform().
+    uint16_t waiting_keys; // pressed since FX0A started waiting.
+    uint64_t random_state; // CXNN draws from this, see seed_random().
+    uint64_t cycles; // instructions run so far.
+    operation_decoder decode_operation; // set by set_quirks().
+    const struct platform* platform;
+
+    struct jit* jit; // only set for ENGINE_JIT.
+    struct latency* latency; // only set with --latency.
+    struct profile* profile; // only set with --profile, see profile.h.
+    struct trace* trace; // only set with --trace, see trace.h.
+    uint64_t rom_hash; // of the whole ROM file, see catalog.h.
+    uint64_t dirty_rows; // bit i set when row i changed since the last draw.
+    uint64_t changed_rows; // the same, but since the last snapshot (see rewind.h).
+    uint32_t effects; // bumped by all that changes memory, the display, sound or flags; see run_cycles().
+    bool skip_idle; // set by load_program(); off runs every instruction, e.g. to time an engine.
+    uint16_t stack[STACK_MAX_DEPTH];
+    struct sound_pattern sound; // set by F002 and FX3A.
+    bool has_pattern; // F002 has run, so `sound` plays instead of a beep.
+    uint8_t planes; // bit p set when DXYN, 00E0 and scrolling act on plane p (FN01).
+    uint8_t flags[REGISTER_SIZE]; // SUPER-CHIP's RPL user flags, for FX75 and FX85.
+    struct display display;
+    uint8_t memory[MEMORY_SIZE];
+
+    // decoded instructions, filled in as they are first run. A slot keeps the
+    // instruction next to its operation so that a handler reads it straight
+    // from here; rebuilding it from memory each time would save 6 KB but costs
+    // more than that saves, as every dispatch would then wait on the rebuild.
+    struct operation cache[CACHE_SIZE];
 };
 
+_Static_assert(offsetof(struct interpreter, platform) + sizeof(void*) <= 64,
+        "the hot fields of struct interpreter no longer fit in one cache line");
+
+bool load_program(struct interpreter* interpreter, const char* filename);
+void seed_random(struct interpreter* interpreter, uint64_t seed);
 uint16_t fetch(struct interpreter* interpreter);
+uint8_t instruction_length(const struct interpreter* interpreter, uint16_t address);
+void set_quirks(struct interpreter* interpreter, uint8_t quirks);
+void set_stack_depth(struct interpreter* interpreter, uint8_t depth);
+void write_memory(struct interpreter* interpreter, uint16_t address, uint8_t value);
 void decode(struct interpreter* interpreter, uint16_t instruction);
-void update_internals(struct interpreter* interpreter, struct screen* screen);
+operation_handler get_handler(uint8_t type);
+void interpret_cycles(struct interpreter* interpreter, uint32_t cycles);
+void thread_cycles(struct interpreter* interpreter, uint32_t cycles);
+void profile_cycles(struct interpreter* interpreter, uint32_t cycles);
+void trace_cycles(struct interpreter* interpreter, uint32_t cycles);
+void run_cycles(struct interpreter* interpreter, uint32_t cycles);
+bool poll_platform(struct interpreter* interpreter);
+void update_internals(struct interpreter* interpreter);
+void tick_timers(struct interpreter* interpreter);
+void clear_display(struct display* display, uint8_t planes);
 
 #endif
@@ -0,0 +1,29 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __JIT_H__
+#define __JIT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct interpreter;
+
+/**
+ * Dynamic recompiler. Runs of CHIP-8 instructions up to the next jump,
+ * call, return, skip, or memory write (a "block") are translated into
+ * x86-64 code the first time they run, and blocks jump straight into
+ * each other without coming back to C.
+ *
+ * Only built for x86-64; elsewhere create_jit() returns NULL and the
+ * interpreter keeps running instructions itself.
+ **/
+struct jit;
+
+struct jit* create_jit(void);
+void destroy_jit(struct jit* jit);
+void jit_run_cycles(struct jit* jit, struct interpreter* interpreter, uint32_t cycles);
+void jit_invalidate(struct jit* jit, uint16_t address);
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Log-linear buckets: exact below 8, then 8 buckets per power of two,
+ * so any value is within 12.5% of its bucket. Enough for any uint64_t.
+ **/
+#define HISTOGRAM_SUB_BITS 3
+#define HISTOGRAM_BUCKETS (62 << HISTOGRAM_SUB_BITS)
+
+struct histogram {
+    uint32_t counts[HISTOGRAM_BUCKETS];
+    uint32_t total;
+    uint64_t max;
+};
+
+void record_histogram(struct histogram* histogram, uint64_t value);
+// the value below which `percent` of those recorded fall, give or take a bucket.
+uint64_t histogram_percentile(const struct histogram* histogram, double percent);
+
+// the steps from a key being touched to the screen showing what it did.
+enum latency_span {
+    SPAN_READ, // key event -> first EX9E, EXA1 or FX0A after it.
+    SPAN_DRAW, // that -> the next DXYN.
+    SPAN_PRESENT, // that -> the frame with it being presented.
+    SPAN_TOTAL, // key event -> presented.
+    SPAN_COUNT
+};
+
+/**
+ * With --latency, follows key events through the program to the screen,
+ * one at a time: events that come while one is being followed are skipped,
+ * unless it has been stuck (say, the program never draws) for
+ * LATENCY_TIMEOUT_NS. All times are on the monotonic clock.
+ *
+ * The interpreter and screen each hold a pointer to this, NULL when not
+ * tracing, so that the instructions involved only pay for a NULL check.
+ **/
+struct latency {
+    uint8_t stage; // the span being waited on, or SPAN_COUNT when idle.
+    uint64_t times[SPAN_COUNT]; // when each stage was reached, key event first.
+    uint32_t abandoned; // events that never made it to the screen.
+    struct histogram spans[SPAN_COUNT];
+};
+
+void init_latency(struct latency* latency);
+// `age` is how long ago, in ns, the event happened.
+void note_key_event(struct latency* latency, uint64_t age);
+void note_key_read(struct latency* latency);
+void note_draw(struct latency* latency);
+void note_present(struct latency* latency);
+void report_latency(FILE* fp, const struct latency* latency);
+
+#endif
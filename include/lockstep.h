@@ -0,0 +1,38 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __LOCKSTEP_H__
+#define __LOCKSTEP_H__
+
+#include <stdint.h>
+
+#include "interpret.h"
+
+#define LOCKSTEP_LANES 32
+
+/**
+ * Runs up to LOCKSTEP_LANES copies of one ROM (differing only in input and
+ * seed) side by side. Registers, I and timers are kept lane by lane in
+ * vectors, so while the copies agree on where they are in the program an
+ * arithmetic instruction runs for all of them at once. A copy that goes its
+ * own way (a skip, a key, a random number) is peeled off and run on its own
+ * until it lands back on the group's program counter.
+ *
+ * Needs GCC/Clang vector extensions; elsewhere create_lockstep() returns NULL.
+ **/
+struct lockstep;
+
+/**
+ * The lanes must already be loaded with the same ROM and quirks, and have
+ * their platforms and seeds set. They stay owned by the caller.
+ **/
+struct lockstep* create_lockstep(struct interpreter* lanes, uint32_t count);
+void destroy_lockstep(struct lockstep* lockstep);
+void lockstep_run_cycles(struct lockstep* lockstep, uint32_t cycles);
+// update_internals() for every lane.
+void lockstep_update_internals(struct lockstep* lockstep);
+// writes every lane's state back to its struct interpreter.
+void lockstep_sync(struct lockstep* lockstep);
+
+#endif
@@ -1,30 +1,28 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: December 30, 2025
+ * Date modified: 10/17/26
  **/
 #ifndef __MEMORY_H__
 #define __MEMORY_H__
 
+#include <stddef.h>
 #include <stdint.h>
 #include <unistd.h>
 
+// a power of two: 4 KB, or XO-CHIP's 64 KB with `make MEMORY_SIZE=65536`.
+#ifndef MEMORY_SIZE
 #define MEMORY_SIZE 4096
-#define STACK_SIZE 1024
+#endif
+#define STACK_MAX_DEPTH 64 // room for calls in every interpreter; see set_stack_depth().
 #define REGISTER_SIZE 16
 #define START_ADDRESS 0x200
 #define FONT_START_ADDRESS 0x50
-
-#define STACK_PUSH(stack, value) \
-    ((stack)->data[(stack)->pointer++] = (value))
-#define STACK_POP(stack) \
-    ((stack)->data[--(stack)->pointer])
-
-struct stack {
-    uint16_t pointer;
-    uint16_t data[STACK_SIZE];
-};
+#define BIG_FONT_START_ADDRESS 0xA0 // SUPER-CHIP's 8x10 digits, for FX30.
+#define MEMORY_PAGE_SIZE (MEMORY_SIZE / 16) // granularity of interpreter->dirty_pages.
+#define MEMORY_PAGES (MEMORY_SIZE / MEMORY_PAGE_SIZE)
 
 void initialize_font(uint8_t* memory);
-ssize_t load_code(uint8_t* memory, int fd);
+ssize_t load_code(uint8_t* memory, int fd, size_t* size, uint64_t* hash);
+ssize_t map_code(uint8_t* memory, int fd, size_t size, uint64_t* hash);
 
 #endif
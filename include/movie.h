@@ -0,0 +1,61 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __MOVIE_H__
+#define __MOVIE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * A recording of a session: everything needed to run it again exactly,
+ * i.e. the settings below plus every change of the keypad, stamped with the
+ * cycle it happened on. The keypad only changes between frames, so replaying
+ * the changes at the same cycles reproduces the run bit for bit.
+ *
+ * On disk (little-endian): "CH8M", a version byte, then the header fields in
+ * the order below, then one record per change: the cycles since the previous
+ * change as a LEB128 varint, and the 16-bit keypad mask.
+ **/
+struct movie_header {
+    uint8_t quirks;
+    uint8_t stack_depth;
+    uint32_t frequency; // instructions per second, as in struct scheduler.
+    uint64_t seed;
+    uint64_t rom_hash; // of the whole ROM file, as in struct interpreter.
+    uint64_t cycles; // length of the recording.
+};
+
+struct movie {
+    FILE* fp;
+    struct movie_header header;
+    const uint64_t* cycles; // the interpreter's count, which changes are timed by.
+    uint64_t last_cycle; // of the last change written or read.
+    uint16_t keys;
+
+    // recording: where the keys really come from.
+    const struct platform* source;
+
+    // replaying: the next change, read ahead.
+    bool pending;
+    uint64_t pending_cycle;
+    uint16_t pending_keys;
+};
+
+bool record_movie(struct movie* movie, const char* filename,
+        const struct movie_header* header, const struct platform* source, const uint64_t* cycles);
+bool replay_movie(struct movie* movie, const char* filename, const uint64_t* cycles);
+// when recording, stamps the header with the final cycle count. Closes the file.
+bool finish_movie(struct movie* movie);
+
+/**
+ * Recording: `source` with every key read going through the movie.
+ * Replaying: the headless platform with keys from the movie.
+ **/
+struct platform movie_platform(struct movie* movie);
+
+#endif
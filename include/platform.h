@@ -0,0 +1,75 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __PLATFORM_H__
+#define __PLATFORM_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "settings.h"
+
+#define HIRES_WIDTH (2 * WIDTH) // SUPER-CHIP's high resolution, 00FF.
+#define HIRES_HEIGHT (2 * HEIGHT)
+#define ROW_WORDS (HIRES_WIDTH / 64)
+#define DISPLAY_PLANES 2 // XO-CHIP's bitplanes, chosen with FN01.
+
+/**
+ * The display is a bitmap per plane, ROW_WORDS uint64_t to a row. Column 0
+ * is the most significant bit of a row's first word, so a row reads left to
+ * right the same way it is printed in binary.
+ *
+ * In low resolution only the first word of the first HEIGHT rows is used,
+ * so a low resolution row is still one uint64_t. Everything outside the
+ * resolution in use is kept clear, and changing resolution clears the rest.
+ **/
+struct display {
+    uint64_t planes[DISPLAY_PLANES][HIRES_HEIGHT][ROW_WORDS];
+    bool hires;
+};
+
+#define DISPLAY_PIXEL(plane, row, column) \
+    (((plane)[row][(column) / 64] >> (63 - (column) % 64)) & 0x01)
+#define DISPLAY_WIDTH(display) ((display)->hires ? HIRES_WIDTH : WIDTH)
+#define DISPLAY_HEIGHT(display) ((display)->hires ? HIRES_HEIGHT : HEIGHT)
+
+/**
+ * XO-CHIP sound: a loop of 128 one-bit samples, played faster or slower
+ * by `pitch`. At DEFAULT_PITCH it plays 4000 samples a second, and every
+ * 48 steps up or down doubles or halves that.
+ **/
+struct sound_pattern {
+    uint8_t bits[16]; // the first sample is the top bit of bits[0].
+    uint8_t pitch;
+};
+
+#define DEFAULT_PITCH 64
+
+/**
+ * Host services the interpreter relies on for input, video, and audio.
+ * Each callback is handed `userdata` back as its first argument, so a
+ * backend (SDL window, headless, ...) can keep whatever state it needs there.
+ **/
+struct platform {
+    void* userdata;
+    // returns false when the host wants emulation to stop.
+    bool (*handle_events)(void* userdata);
+    // the keypad, with bit i set while key i is held. Read once a frame.
+    uint16_t (*read_keys)(void* userdata);
+    // only called on frames where the display changed.
+    void (*draw_display)(void* userdata, const struct display* display);
+    // `pattern` is NULL until the program sets one, for the usual beep.
+    void (*play_sound)(void* userdata, uint8_t timer_value, const struct sound_pattern* pattern);
+};
+
+// No window, no audio, no keys. Needs no userdata.
+extern const struct platform headless_platform;
+
+/**
+ * The display as 32-bit texels at its resolution, for platforms that draw
+ * it. Each pixel is one of four colors, by which planes have it set.
+ **/
+void expand_display(const struct display* display, void* pixels, int pitch);
+
+#endif
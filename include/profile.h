@@ -0,0 +1,45 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+
+// time spent in one part of the emulator.
+struct timing {
+    uint64_t calls;
+    uint64_t ns;
+};
+
+/**
+ * What --profile counts. While the interpreter points at one of these,
+ * run_cycles() goes through profile_cycles(), a copy of the plain
+ * interpreter loop that also counts, whatever the engine; otherwise the
+ * only cost is one NULL check a frame.
+ **/
+struct profile {
+    uint64_t operations[OP_COUNT]; // instructions run of each enum operation_type.
+    uint64_t addresses[MEMORY_SIZE]; // instructions run at each address.
+    struct timing decode; // filling in the decode cache.
+    struct timing draw_sprite; // DXYN.
+    struct timing draw_display; // handing a frame to the platform.
+    struct timing run; // all of run_cycles().
+    uint64_t clock_ns; // what reading the clock costs, taken off every timing.
+    uint64_t start_ns; // when profiling started.
+};
+
+void init_profile(struct profile* profile);
+// adds the time since `start`, from monotonic_ns(), to `timing`.
+void end_timing(const struct profile* profile, struct timing* timing, uint64_t start);
+// CSV when `filename` ends in .csv, text otherwise.
+bool write_profile(const struct profile* profile, const char* filename);
+
+#endif
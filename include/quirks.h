@@ -0,0 +1,42 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __QUIRKS_H__
+#define __QUIRKS_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Behaviours that differ between CHIP-8 implementations. ROMs were written
+ * against one implementation or another and break on the rest, so these
+ * are chosen per ROM. Each combination gets its own decoder (see
+ * interpret.c), so nothing is checked while instructions run.
+ **/
+enum quirk {
+    QUIRK_SHIFT_VY = 0x01,          // 8XY6 / 8XYE shift VY into VX, instead of VX in place.
+    QUIRK_JUMP_VX = 0x02,           // BXNN jumps to VX + XNN, instead of V0 + NNN.
+    QUIRK_INDEX_FLAG = 0x04,        // FX1E sets VF when I goes past 0xFFF.
+    QUIRK_INDEX_INCREMENT = 0x08,   // FX55 / FX65 leave I at I + X + 1.
+    QUIRK_INDEX_INCREMENT_X = 0x10  // FX55 / FX65 leave I at I + X.
+};
+
+// Number of distinct sets of quirks, i.e. of decoders.
+#define QUIRK_COMBINATIONS 0x20
+
+struct quirk_profile {
+    const char* name;
+    uint8_t quirks;
+};
+
+// Ends with an entry whose name is NULL.
+extern const struct quirk_profile quirk_profiles[];
+
+/**
+ * Looks up a profile by name, or takes a number as a raw set of quirks.
+ * @return  whether `name` was understood.
+ **/
+bool parse_quirks(const char* name, uint8_t* quirks);
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __REWIND_H__
+#define __REWIND_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+#include "platform.h"
+
+// one snapshot per frame.
+#define REWIND_FRAMES (REWIND_SECONDS * TIMER_FREQUENCY)
+
+/**
+ * The small part of the machine, kept whole in every snapshot.
+ * The rest (memory pages, display rows, stack entries) is only kept
+ * where it changed; see save_snapshot().
+ **/
+struct machine_state {
+    uint8_t registers[REGISTER_SIZE];
+    uint16_t program_counter;
+    uint16_t index_register;
+    uint8_t stack_pointer;
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t fault;
+    uint16_t keys;
+    uint16_t waiting_keys;
+    uint64_t random_state;
+    uint64_t cycles;
+    struct sound_pattern sound;
+    bool has_pattern;
+    bool hires;
+    uint8_t planes;
+    uint8_t flags[REGISTER_SIZE];
+};
+
+/**
+ * History for rewinding, one snapshot per frame in a ring of
+ * REWIND_BUFFER_SIZE bytes. A snapshot undoes one frame: it holds the
+ * previous frame's value of everything that frame changed, so stepping back
+ * just copies it over the machine. When the ring is full the oldest
+ * snapshots are dropped.
+ **/
+struct rewind {
+    uint8_t* buffer;
+    size_t* offsets; // where each snapshot starts in buffer, REWIND_FRAMES of them.
+    size_t first; // index in offsets of the oldest snapshot.
+    size_t count;
+    size_t end; // one past the newest snapshot in buffer.
+
+    // the machine as of the newest snapshot, to tell what changed since.
+    struct machine_state state;
+    uint8_t memory[MEMORY_SIZE];
+    struct display display;
+    uint16_t stack[STACK_MAX_DEPTH];
+};
+
+bool init_rewind(struct rewind* rewind, struct interpreter* interpreter);
+void destroy_rewind(struct rewind* rewind);
+void save_snapshot(struct rewind* rewind, struct interpreter* interpreter);
+// steps back one frame. Returns false when there is no history left.
+bool rewind_snapshot(struct rewind* rewind, struct interpreter* interpreter);
+
+#endif
@@ -0,0 +1,30 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <stdint.h>
+
+#include "settings.h"
+
+/**
+ * Paces emulation in 60 Hz frames: the caller runs a batch of instructions,
+ * ticks the timers, then sleeps until the next frame's deadline.
+ * Deadlines are taken from the monotonic clock, so wall time (not CPU time)
+ * decides the speed.
+ **/
+struct scheduler {
+    uint32_t frequency; // instructions per second.
+    uint32_t leftover;  // fractional instructions carried to the next frame.
+    uint64_t deadline;  // in ns on the monotonic clock.
+};
+
+void init_scheduler(struct scheduler* scheduler, uint32_t frequency);
+void set_cycles_per_frame(struct scheduler* scheduler, uint32_t cycles);
+uint32_t next_batch(struct scheduler* scheduler);
+void wait_for_frame(struct scheduler* scheduler);
+uint64_t monotonic_ns(void);
+
+#endif
@@ -1,6 +1,6 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: December 30, 2025
+ * Date modified: 10/17/26
  **/
 #ifndef __DISPLAY_H__
 #define __DISPLAY_H__
@@ -10,20 +10,32 @@
 #include <stdint.h>
 
 #include "settings.h"
+#include "platform.h"
+#include "audio.h"
+#include "latency.h"
 
 struct screen {
     SDL_Window* window;
     SDL_Renderer* renderer;
+    SDL_Texture* texture; // WIDTH x HEIGHT, one texel per CHIP-8 pixel.
+    SDL_Texture* hires_texture; // HIRES_WIDTH x HIRES_HEIGHT, for SUPER-CHIP's hi-res mode.
+    SDL_Texture* shown; // whichever of the two was drawn last.
     SDL_AudioStream* stream;
+    SDL_Gamepad* gamepad; // NULL until one is plugged in.
+    struct audio audio; // only touched with the stream locked.
+    bool rewinding; // backspace is held, as of the last handle_event().
+    bool fast_forwarding; // tab is held, likewise.
+    uint64_t refresh_ns; // between refreshes of the window's display.
+    struct latency* latency; // only set with --latency.
+    uint8_t keymap[16]; // the CHIP-8 key each keyboard key plays; see catalog.h.
 };
 
 bool init_screen(struct screen* screen);
-bool handle_event(void);
-bool is_key_pressed(uint8_t num);
-uint8_t any_key_pressed(void);
-void draw_display(SDL_Renderer* renderer, bool display[][WIDTH]);
-void clear_display(bool display[][WIDTH]);
+bool handle_event(struct screen* screen);
+uint16_t read_keys(struct screen* screen);
+void draw_display(struct screen* screen, const struct display* display);
 void destroy_screen(struct screen* screen);
-void play_sound(SDL_AudioStream* stream, uint8_t timer_value);
+void play_sound(struct screen* screen, uint8_t timer_value, const struct sound_pattern* pattern);
+struct platform screen_platform(struct screen* screen);
 
 #endif
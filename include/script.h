@@ -0,0 +1,38 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __SCRIPT_H__
+#define __SCRIPT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+/**
+ * Keypad input read from a file instead of a keyboard, for unattended runs.
+ * Each line is `<frame> <keys>`: from that frame on, the keypad is `keys`,
+ * a hex mask with bit i set while key i is held. Lines are in frame order;
+ * blank lines and lines starting with '#' are skipped.
+ **/
+struct script_event {
+    uint64_t frame;
+    uint16_t keys;
+};
+
+struct script {
+    struct script_event* events;
+    size_t count;
+    size_t next; // first event not yet applied.
+    uint64_t frame;
+    uint16_t keys; // currently held.
+};
+
+bool load_script(struct script* script, const char* filename);
+void free_script(struct script* script);
+// Everything but input behaves as the headless platform.
+struct platform script_platform(struct script* script);
+
+#endif
@@ -1,26 +1,30 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: 01/02/26
+ * Date modified: 10/17/26
  **/
 #ifndef __SETTINGS_H__
 #define __SETTINGS_H__
 
 /* Configurables parameters. */
 #define TIMER_FREQUENCY 60 // in Hz.
-#define FREQUENCY 500 // in Hz. Modifiable.
-#define CYCLE_TIME (1.0 / (FREQUENCY))
-#define TIMER_CYCLE_TIME (1.0 / (TIMER_FREQUENCY))
-#define WIDTH 64
+#define FREQUENCY 500 // in Hz. Default; --cycles-per-frame overrides it.
+#define WIDTH 64 // one display row is packed into a uint64_t, so keep this 64.
 #define HEIGHT 32
 #define OFF_COLOR 0x480000
-#define ON_COLOR  0xE86A43
+#define ON_COLOR  0xE86A43 // of the first plane, i.e. of every pixel without XO-CHIP's FN01.
+#define PLANE_2_COLOR 0x4A8FB0 // pixels only set in the second.
+#define BOTH_PLANES_COLOR 0xF2E6C2
 #define SOUND_FREQUENCY 440
+#define SAMPLE_RATE 48000 // of the audio output, in Hz.
+#define STACK_DEPTH 32 // levels of calls. Default; --stack-depth overrides it.
+#define REWIND_SECONDS 60 // how far back holding backspace can go.
+#define REWIND_BUFFER_SIZE (4 << 20) // in bytes, for all of those seconds.
+#define TURBO_FRAME_SKIP 8 // fast-forward shows at most one emulated frame in this many.
+#define TRACE_RECORDS (1 << 22) // instructions --trace keeps, the newest. 16 bytes each.
 
 /* Configurable settings. */
-#undef  SHIFT_OPTION
-#undef  JUMP_OFFSET_OPTION
-#undef  INDEX_ADD_OOB_OPTION
-#undef  LOAD_STORE_MODIFY_INDEX_OPTION
+#define DEFAULT_QUIRKS "modern" // a profile in quirks.c; --quirks overrides it.
+#define CATALOG_FILE "catalog.txt" // settings for known ROMs; --catalog overrides it.
 
 #endif
 
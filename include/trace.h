@@ -0,0 +1,76 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define TRACE_MAGIC "CH8T"
+#define TRACE_VERSION 1
+#define TRACE_NO_REGISTER 0xFF
+
+/**
+ * One instruction run, as of just after it ran.
+ **/
+struct trace_record {
+    uint64_t cycle; // how many instructions ran before this one.
+    uint16_t program_counter; // where it was.
+    uint16_t instruction;
+    uint16_t index_register;
+    uint8_t changed; // the lowest register it changed, or TRACE_NO_REGISTER.
+    uint8_t value; // what that register became.
+};
+
+_Static_assert(sizeof(struct trace_record) == 16, "trace records are meant to be 16 bytes");
+
+/**
+ * A trace file is this header, padded to a page, then `capacity` records
+ * used as a ring: record n is at n % capacity, so once it wraps only the
+ * newest `capacity` are kept.
+ **/
+struct trace_header {
+    char magic[4]; // TRACE_MAGIC.
+    uint32_t version; // TRACE_VERSION.
+    uint32_t record_size; // sizeof(struct trace_record).
+    uint32_t records_offset; // where the ring starts in the file.
+    uint64_t capacity; // a power of two.
+    uint64_t head; // records written in all.
+};
+
+/**
+ * With --trace, the interpreter writes each instruction straight into the
+ * file through a shared mapping, and so never makes a system call for it.
+ * A flusher thread wakes every so often to have the kernel write out what
+ * was added since (msync), so the file is close to current even if the
+ * emulator dies, without the emulator ever waiting on the disk.
+ *
+ * The emulator only tells the flusher how far it got (header->head) once a
+ * batch; records in between are counted in `head`.
+ **/
+struct trace {
+    int fd;
+    uint8_t* map;
+    size_t size; // of the file and the mapping.
+    struct trace_header* header;
+    struct trace_record* records;
+    uint64_t mask; // capacity - 1.
+    uint64_t head;
+
+    pthread_t flusher;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool stopping;
+};
+
+// `capacity` is rounded up to a power of two.
+bool open_trace(struct trace* trace, const char* filename, uint64_t capacity);
+void close_trace(struct trace* trace);
+// makes the records written so far visible to the flusher, and to readers.
+void publish_trace(struct trace* trace);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "settings.h"
+#include "platform.h"
+#include "audio.h"
+
+#define VOLUME 0.5f
+#define PATTERN_RATE 4000.0 // samples per second at DEFAULT_PITCH.
+
+// the step through a table that plays it `frequency` times a second.
+static uint32_t step_for(double frequency) {
+    return (uint32_t) (frequency * 4294967296.0 / SAMPLE_RATE);
+}
+
+static void load_sine(struct audio* audio) {
+    for(uint32_t i = 0; i < WAVETABLE_SIZE; i++) {
+        audio->wavetable[i] = VOLUME * SDL_sinf(2 * SDL_PI_F * i / WAVETABLE_SIZE);
+    }
+    audio->table_bits = WAVETABLE_BITS;
+    audio->step = step_for(SOUND_FREQUENCY);
+    audio->has_pattern = false;
+}
+
+static void load_pattern(struct audio* audio, const struct sound_pattern* pattern) {
+    for(uint32_t i = 0; i < (1 << PATTERN_BITS); i++) {
+        bool bit = (pattern->bits[i / 8] >> (7 - i % 8)) & 0x01;
+        audio->wavetable[i] = bit ? VOLUME : -VOLUME;
+    }
+    audio->table_bits = PATTERN_BITS;
+    float rate = PATTERN_RATE * SDL_powf(2.0f, (pattern->pitch - DEFAULT_PITCH) / 48.0f);
+    audio->step = step_for(rate / (1 << PATTERN_BITS));
+    audio->pattern = *pattern;
+    audio->has_pattern = true;
+}
+
+void init_audio(struct audio* audio) {
+    memset(audio, 0, sizeof(*audio));
+    load_sine(audio);
+}
+
+/**
+ * Called once a frame with the sound timer, which counts down at
+ * TIMER_FREQUENCY, so it is good for that many frames' worth of samples.
+ **/
+void set_audio(struct audio* audio, uint8_t timer_value, const struct sound_pattern* pattern) {
+    audio->gate = timer_value * (SAMPLE_RATE / TIMER_FREQUENCY);
+    if(pattern == NULL) {
+        if(audio->has_pattern) load_sine(audio);
+    } else if(!audio->has_pattern || memcmp(pattern, &audio->pattern, sizeof(*pattern)) != 0) {
+        load_pattern(audio, pattern);
+    }
+}
+
+void render_audio(struct audio* audio, float* samples, uint32_t count) {
+    uint32_t playing = count < audio->gate ? count : audio->gate;
+    uint8_t shift = 32 - audio->table_bits;
+    for(uint32_t i = 0; i < playing; i++) {
+        samples[i] = audio->wavetable[audio->phase >> shift];
+        audio->phase += audio->step;
+    }
+    memset(samples + playing, 0, (count - playing) * sizeof(float));
+    audio->gate -= playing;
+}
+
+#undef PATTERN_RATE
+#undef VOLUME
@@ -0,0 +1,448 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "settings.h"
+#include "platform.h"
+#include "interpret.h"
+#include "scheduler.h"
+#include "script.h"
+#include "debug.h"
+#include "jit.h"
+#include "lockstep.h"
+#include "batch.h"
+
+#define PATH_LENGTH 512
+
+struct job {
+    char rom[PATH_LENGTH];
+    char script[PATH_LENGTH]; // empty for no input.
+    uint64_t cycles;
+    uint64_t seed;
+    uint64_t expected; // the display hash it should end with, for check_golden().
+
+    // filled in by whichever worker runs it.
+    bool ok;
+    uint64_t hash;
+    uint64_t executed;
+    uint16_t program_counter;
+    uint16_t index_register;
+    uint8_t registers[REGISTER_SIZE];
+};
+
+// what a worker takes at a time: one job, or several run in lockstep.
+struct unit {
+    size_t first;
+    size_t count;
+};
+
+/**
+ * Each worker owns a run of units [head, tail) and takes from the head.
+ * Once its own run is empty it steals the back half of someone else's,
+ * so a worker stuck on a long job does not hold up the ones queued behind it.
+ **/
+struct worker {
+    pthread_t thread;
+    pthread_mutex_t lock;
+    size_t head;
+    size_t tail;
+    uint32_t id;
+    struct batch* batch;
+};
+
+struct batch {
+    struct job* jobs;
+    size_t count;
+    struct unit* units;
+    size_t unit_count;
+    struct worker* workers;
+    uint32_t worker_count;
+    const struct batch_options* options;
+};
+
+void run_headless(struct interpreter* interpreter,
+        struct scheduler* scheduler, uint64_t cycles) {
+    uint64_t executed = 0;
+    while(cycles == 0 || executed < cycles) {
+        uint32_t batch = next_batch(scheduler);
+        if(cycles != 0 && cycles - executed < batch) {
+            batch = cycles - executed;
+        }
+        run_cycles(interpreter, batch);
+        executed += batch;
+
+        if(!poll_platform(interpreter)) break;
+        update_internals(interpreter);
+    }
+}
+
+static void init_scheduler_for(struct scheduler* scheduler, const struct batch_options* options) {
+    init_scheduler(scheduler, FREQUENCY);
+    if(options->cycles_per_frame != 0) {
+        set_cycles_per_frame(scheduler, options->cycles_per_frame);
+    }
+}
+
+// loads the job's ROM, seed, and input, with `platform` pointing at the input.
+static bool prepare_job(const struct job* job, const struct batch_options* options,
+        struct interpreter* interpreter, struct script* script, struct platform* platform) {
+    *script = (struct script) {0};
+    if(!load_program(interpreter, job->rom)) return false;
+    set_quirks(interpreter, options->quirks);
+    set_stack_depth(interpreter, options->stack_depth);
+    seed_random(interpreter, job->seed);
+
+    *platform = headless_platform;
+    if(job->script[0] != '\0') {
+        if(!load_script(script, job->script)) return false;
+        *platform = script_platform(script);
+    }
+    interpreter->platform = platform;
+    return true;
+}
+
+static void record_result(struct job* job, const struct interpreter* interpreter) {
+    job->hash = hash_display(&interpreter->display);
+    job->executed = interpreter->cycles;
+    job->program_counter = interpreter->program_counter;
+    job->index_register = interpreter->index_register;
+    memcpy(job->registers, interpreter->registers, REGISTER_SIZE);
+    job->ok = true;
+}
+
+static void run_job(struct job* job, const struct batch_options* options,
+        struct interpreter* interpreter) {
+    struct script script;
+    struct platform platform;
+    if(!prepare_job(job, options, interpreter, &script, &platform)) {
+        free_script(&script);
+        return;
+    }
+
+    interpreter->engine = options->engine;
+    if(options->engine == ENGINE_JIT && (interpreter->jit = create_jit()) == NULL) {
+        interpreter->engine = ENGINE_INTERPRETER;
+    }
+
+    struct scheduler scheduler;
+    init_scheduler_for(&scheduler, options);
+    run_headless(interpreter, &scheduler, job->cycles);
+    record_result(job, interpreter);
+
+    destroy_jit(interpreter->jit);
+    free_script(&script);
+}
+
+/**
+ * The same frame loop as run_headless(), for `count` jobs of one ROM at once.
+ * Falls back to running them one by one if they cannot all be set up.
+ **/
+static void run_pack(struct job* jobs, size_t count, const struct batch_options* options,
+        struct interpreter* lanes) {
+    struct script scripts[LOCKSTEP_LANES];
+    struct platform platforms[LOCKSTEP_LANES];
+    struct lockstep* lockstep = NULL;
+    size_t prepared = 0;
+    while(prepared < count && prepare_job(&jobs[prepared], options, &lanes[prepared],
+                &scripts[prepared], &platforms[prepared])) {
+        prepared++;
+    }
+    if(prepared == count) {
+        lockstep = create_lockstep(lanes, count);
+    }
+
+    if(lockstep != NULL) {
+        struct scheduler scheduler;
+        init_scheduler_for(&scheduler, options);
+        uint64_t cycles = jobs[0].cycles;
+        uint64_t executed = 0;
+        while(executed < cycles) {
+            uint32_t batch = next_batch(&scheduler);
+            if(cycles - executed < batch) {
+                batch = cycles - executed;
+            }
+            lockstep_run_cycles(lockstep, batch);
+            executed += batch;
+
+            for(size_t i = 0; i < count; i++) {
+                poll_platform(&lanes[i]);
+            }
+            lockstep_update_internals(lockstep);
+        }
+        lockstep_sync(lockstep);
+        destroy_lockstep(lockstep);
+
+        for(size_t i = 0; i < count; i++) {
+            record_result(&jobs[i], &lanes[i]);
+        }
+    }
+
+    // prepare_job() got as far as clearing the script of the one that failed.
+    for(size_t i = 0; i < count && i <= prepared; i++) {
+        free_script(&scripts[i]);
+    }
+    if(lockstep == NULL) {
+        for(size_t i = 0; i < count; i++) {
+            run_job(&jobs[i], options, &lanes[0]);
+        }
+    }
+}
+
+static bool take_unit(struct worker* worker, size_t* unit) {
+    bool found = false;
+    pthread_mutex_lock(&worker->lock);
+    if(worker->head < worker->tail) {
+        *unit = worker->head++;
+        found = true;
+    }
+    pthread_mutex_unlock(&worker->lock);
+    return found;
+}
+
+static bool steal_unit(struct worker* thief, size_t* unit) {
+    struct batch* batch = thief->batch;
+    for(uint32_t i = 1; i < batch->worker_count; i++) {
+        struct worker* victim = &batch->workers[(thief->id + i) % batch->worker_count];
+
+        pthread_mutex_lock(&victim->lock);
+        size_t left = victim->tail - victim->head;
+        size_t start = victim->tail - left / 2 - (left & 0x01);
+        size_t end = victim->tail;
+        victim->tail = start;
+        pthread_mutex_unlock(&victim->lock);
+        if(start == end) continue;
+
+        // run the first stolen unit now and queue the rest as our own.
+        pthread_mutex_lock(&thief->lock);
+        thief->head = start + 1;
+        thief->tail = end;
+        pthread_mutex_unlock(&thief->lock);
+        *unit = start;
+        return true;
+    }
+    return false;
+}
+
+static void* work(void* argument) {
+    struct worker* worker = argument;
+    struct batch* batch = worker->batch;
+    size_t lanes = batch->options->lockstep ? LOCKSTEP_LANES : 1;
+    // struct interpreter is cache-line aligned, which malloc does not promise.
+    struct interpreter* interpreters = aligned_alloc(_Alignof(struct interpreter),
+            lanes * sizeof(*interpreters));
+    if(interpreters == NULL) {
+        fprintf(stderr, "Out of memory for worker %u\n", worker->id);
+        return NULL;
+    }
+
+    size_t index;
+    while(take_unit(worker, &index) || steal_unit(worker, &index)) {
+        const struct unit* unit = &batch->units[index];
+        if(unit->count == 1) {
+            run_job(&batch->jobs[unit->first], batch->options, interpreters);
+        } else {
+            run_pack(&batch->jobs[unit->first], unit->count, batch->options, interpreters);
+        }
+    }
+
+    free(interpreters);
+    return NULL;
+}
+
+/**
+ * Returns the number of jobs read, or -1 on failure.
+ * With `golden`, every line starts with the hash the job is expected to end with.
+ **/
+static ssize_t read_manifest(const char* filename, struct job** jobs, bool golden) {
+    FILE* fp = fopen(filename, "r");
+    if(fp == NULL) {
+        fprintf(stderr, "Failure in reading '%s'\n", filename);
+        return -1;
+    }
+
+    *jobs = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    uint32_t line_number = 0;
+    char line[4 * PATH_LENGTH];
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        char rom[PATH_LENGTH];
+        char script[PATH_LENGTH] = "";
+        unsigned long long cycles;
+        unsigned long long seed = 0;
+        unsigned long long expected = 0;
+        int skip = 0;
+        char first;
+        if(sscanf(line, " %c", &first) != 1 || first == '#') continue;
+        if((golden && sscanf(line, "%llx %n", &expected, &skip) != 1) ||
+                sscanf(line + skip, "%511s %llu %llu %511s", rom, &cycles, &seed, script) < 2 ||
+                cycles == 0) {
+            fprintf(stderr, "%s:%u: expected '%s<rom> <cycles> [seed] [input script]'\n",
+                    filename, line_number, golden ? "<hash> " : "");
+            goto fail;
+        }
+
+        if(count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            struct job* grown = realloc(*jobs, capacity * sizeof(*grown));
+            if(grown == NULL) {
+                fprintf(stderr, "Out of memory reading '%s'\n", filename);
+                goto fail;
+            }
+            *jobs = grown;
+        }
+
+        struct job* job = &(*jobs)[count++];
+        *job = (struct job) {.cycles = cycles, .seed = seed, .expected = expected};
+        strcpy(job->rom, rom);
+        if(strcmp(script, "-") != 0) {
+            strcpy(job->script, script);
+        }
+    }
+
+    fclose(fp);
+    return count;
+
+fail:
+    fclose(fp);
+    free(*jobs);
+    *jobs = NULL;
+    return -1;
+}
+
+// runs every job in batch->jobs to completion, or returns false if it can't start.
+static bool run_jobs(struct batch* batch) {
+    const struct batch_options* options = batch->options;
+    batch->units = malloc((batch->count > 0 ? batch->count : 1) * sizeof(*batch->units));
+    if(batch->units == NULL) {
+        fprintf(stderr, "Out of memory for %zu jobs\n", batch->count);
+        return false;
+    }
+    for(size_t i = 0; i < batch->count; i++) {
+        struct unit* last = batch->unit_count > 0 ? &batch->units[batch->unit_count - 1] : NULL;
+        if(options->lockstep && last != NULL && last->count < LOCKSTEP_LANES &&
+                batch->jobs[last->first].cycles == batch->jobs[i].cycles &&
+                strcmp(batch->jobs[last->first].rom, batch->jobs[i].rom) == 0) {
+            last->count++;
+        } else {
+            batch->units[batch->unit_count++] = (struct unit) {i, 1};
+        }
+    }
+
+    uint32_t threads = options->threads;
+    if(threads == 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cores > 0 ? cores : 1;
+    }
+    if(threads > batch->unit_count) threads = batch->unit_count > 0 ? batch->unit_count : 1;
+
+    batch->workers = calloc(threads, sizeof(*batch->workers));
+    if(batch->workers == NULL) {
+        fprintf(stderr, "Out of memory starting %u workers\n", threads);
+        free(batch->units);
+        return false;
+    }
+    batch->worker_count = threads;
+
+    // hand out contiguous runs up front; stealing evens out the rest.
+    for(uint32_t i = 0; i < threads; i++) {
+        struct worker* worker = &batch->workers[i];
+        worker->id = i;
+        worker->batch = batch;
+        worker->head = batch->unit_count * i / threads;
+        worker->tail = batch->unit_count * (i + 1) / threads;
+        pthread_mutex_init(&worker->lock, NULL);
+    }
+    // worker 0 is this thread; the runs of any that fail to start are stolen.
+    uint32_t started = 1;
+    while(started < threads &&
+            pthread_create(&batch->workers[started].thread, NULL, work,
+                           &batch->workers[started]) == 0) {
+        started++;
+    }
+    if(started < threads) {
+        fprintf(stderr, "Failure in starting workers; only %u of %u are running\n", started, threads);
+    }
+    work(&batch->workers[0]);
+    for(uint32_t i = 1; i < started; i++) {
+        pthread_join(batch->workers[i].thread, NULL);
+    }
+
+    for(uint32_t i = 0; i < threads; i++) {
+        pthread_mutex_destroy(&batch->workers[i].lock);
+    }
+    free(batch->workers);
+    free(batch->units);
+    return true;
+}
+
+int run_batch(const char* manifest, const struct batch_options* options, FILE* out) {
+    struct batch batch = {.options = options};
+    ssize_t count = read_manifest(manifest, &batch.jobs, false);
+    if(count < 0) return -1;
+    batch.count = count;
+    if(!run_jobs(&batch)) {
+        free(batch.jobs);
+        return -1;
+    }
+
+    int failed = 0;
+    for(size_t i = 0; i < batch.count; i++) {
+        const struct job* job = &batch.jobs[i];
+        if(!job->ok) {
+            fprintf(out, "%s failed\n", job->rom);
+            failed++;
+            continue;
+        }
+        fprintf(out, "%s seed=%llu cycles=%llu hash=%016llx pc=%03X i=%03X v=",
+                job->rom, (unsigned long long) job->seed, (unsigned long long) job->executed,
+                (unsigned long long) job->hash, job->program_counter, job->index_register);
+        for(uint8_t r = 0; r < REGISTER_SIZE; r++) {
+            fprintf(out, "%02X", job->registers[r]);
+        }
+        fprintf(out, "\n");
+    }
+
+    free(batch.jobs);
+    return failed;
+}
+
+int check_golden(const char* golden, const struct batch_options* options, FILE* out) {
+    struct batch batch = {.options = options};
+    ssize_t count = read_manifest(golden, &batch.jobs, true);
+    if(count < 0) return -1;
+    batch.count = count;
+    uint64_t start = monotonic_ns();
+    if(!run_jobs(&batch)) {
+        free(batch.jobs);
+        return -1;
+    }
+    double seconds = (monotonic_ns() - start) / 1e9;
+
+    int failed = 0;
+    for(size_t i = 0; i < batch.count; i++) {
+        const struct job* job = &batch.jobs[i];
+        if(!job->ok) {
+            fprintf(out, "FAIL %s: could not be run\n", job->rom);
+            failed++;
+        } else if(job->hash != job->expected) {
+            fprintf(out, "FAIL %s%s%s: expected %016llx, got %016llx\n", job->rom,
+                    job->script[0] != '\0' ? " with " : "", job->script,
+                    (unsigned long long) job->expected, (unsigned long long) job->hash);
+            failed++;
+        }
+    }
+    fprintf(out, "%s: %zu of %zu match in %.3f s\n", golden,
+            batch.count - failed, batch.count, seconds);
+    free(batch.jobs);
+    return failed;
+}
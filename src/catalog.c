@@ -0,0 +1,121 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catalog.h"
+#include "quirks.h"
+
+#define HASH_DIGITS 16
+#define LINE_SIZE 256
+
+// `field` is '-', or 16 hex digits.
+static bool parse_keymap(const char* field, struct catalog_entry* entry) {
+    if(strcmp(field, "-") == 0) return true;
+    if(strlen(field) != 16) return false;
+    for(int i = 0; i < 16; i++) {
+        char digit[2] = {field[i], '\0'};
+        char* end;
+        entry->keymap[i] = strtoul(digit, &end, 16);
+        if(*end != '\0') return false;
+    }
+    entry->has_keymap = true;
+    return true;
+}
+
+// everything after the hash on one line.
+static bool parse_entry(const char* line, struct catalog_entry* entry) {
+    char quirks[32];
+    char cycles[32];
+    char keymap[32];
+    int skip = 0;
+    *entry = (struct catalog_entry) {0};
+    if(sscanf(line, " %31s %31s %31s %n", quirks, cycles, keymap, &skip) != 3) return false;
+
+    if(strcmp(quirks, "-") != 0) {
+        if(!parse_quirks(quirks, &entry->quirks)) return false;
+        entry->has_quirks = true;
+    }
+    if(strcmp(cycles, "-") != 0) {
+        char* end;
+        entry->cycles_per_frame = strtoul(cycles, &end, 10);
+        if(*end != '\0' || entry->cycles_per_frame == 0) return false;
+    }
+    if(!parse_keymap(keymap, entry)) return false;
+
+    size_t length = strcspn(line + skip, "\r\n");
+    if(length >= CATALOG_NAME_SIZE) length = CATALOG_NAME_SIZE - 1;
+    memcpy(entry->name, line + skip, length);
+    entry->name[length] = '\0';
+    return true;
+}
+
+int find_in_catalog(const char* filename, uint64_t hash, struct catalog_entry* entry, bool required) {
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        if(errno == ENOENT && !required) return 0;
+        fprintf(stderr, "Failure in reading the catalog '%s'\n", filename);
+        return -1;
+    }
+    struct stat status;
+    if(fstat(fd, &status) != 0) {
+        fprintf(stderr, "Failure in reading the catalog '%s'\n", filename);
+        close(fd);
+        return -1;
+    }
+    size_t size = status.st_size;
+    if(size == 0) {
+        close(fd);
+        return 0;
+    }
+    const char* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED) {
+        fprintf(stderr, "Failure in mapping the catalog '%s'\n", filename);
+        return -1;
+    }
+
+    char wanted[HASH_DIGITS + 1];
+    snprintf(wanted, sizeof(wanted), "%016llx", (unsigned long long) hash);
+    int found = 0;
+    uint32_t line_number = 0;
+    for(const char* line = map; line < map + size && found == 0; ) {
+        const char* end = memchr(line, '\n', map + size - line);
+        if(end == NULL) end = map + size;
+        line_number++;
+        // only a line for this ROM is worth parsing.
+        if(end - line > HASH_DIGITS && strncasecmp(line, wanted, HASH_DIGITS) == 0 &&
+                (line[HASH_DIGITS] == ' ' || line[HASH_DIGITS] == '\t')) {
+            char copy[LINE_SIZE];
+            size_t length = end - line - HASH_DIGITS;
+            if(length >= LINE_SIZE) length = LINE_SIZE - 1;
+            memcpy(copy, line + HASH_DIGITS, length);
+            copy[length] = '\0';
+            if(parse_entry(copy, entry)) {
+                found = 1;
+            } else {
+                fprintf(stderr, "%s:%u: expected '<hash> <quirks> <cycles per frame> <keymap> [name]'\n",
+                        filename, line_number);
+                found = -1;
+            }
+        }
+        line = end + 1;
+    }
+
+    munmap((void*) map, size);
+    return found;
+}
+
+#undef LINE_SIZE
+#undef HASH_DIGITS
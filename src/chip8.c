@@ -1,82 +1,379 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: December 31, 2025
+ * Date modified: 10/17/26
  **/
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
-#include <SDL3/SDL.h>
-#include <fcntl.h>
+#include <string.h>
 #include <time.h>
 
 #include "settings.h"
 #include "memory.h"
-#include "screen.h"
+#include "platform.h"
 #include "interpret.h"
 #include "debug.h"
+#include "scheduler.h"
+#include "quirks.h"
+#include "batch.h"
+#include "movie.h"
+#include "rewind.h"
+#include "latency.h"
+#include "profile.h"
+#include "trace.h"
+#include "catalog.h"
+#ifndef CHIP8_HEADLESS
+#include "screen.h"
+#endif
+
+static void usage(FILE* fp) {
+    fprintf(fp, "Usage: ./chip8 [-g] [--headless] [--threaded | --jit] [--cycles N] "
+            "[--cycles-per-frame N] [--quirks PROFILE] [--stack-depth N] [--seed N] "
+            "[--record MOVIE] [--latency] [--turbo] [--profile FILE | --trace FILE] [--catalog FILE] <file>\n");
+    fprintf(fp, "       ./chip8 --hash <file>\n");
+    fprintf(fp, "       ./chip8 --replay MOVIE [--threaded | --jit] [--profile FILE | --trace FILE] <file>\n");
+    fprintf(fp, "       ./chip8 --batch MANIFEST [--threads N] [--lockstep] [--threaded | --jit] "
+            "[--cycles-per-frame N] [--quirks PROFILE] [--stack-depth N]\n");
+    fprintf(fp, "       ./chip8 --check GOLDEN [--threads N] [--lockstep] [--threaded | --jit]\n");
+    fprintf(fp, "       ./chip8 --sizes\n");
+    fprintf(fp, "Quirk profiles:");
+    for(const struct quirk_profile* profile = quirk_profiles; profile->name != NULL; profile++) {
+        fprintf(fp, " %s", profile->name);
+    }
+    fprintf(fp, "\n");
+}
 
 int main(int argc, char* argv[]) {
-    srand(time(NULL));
-    if(argc == 1) {
-        fprintf(stderr, "Usage: ./chip8 <file>\n");
+    int debug = 0;
+    int headless = 0;
+    uint8_t engine = ENGINE_INTERPRETER;
+    uint64_t cycles = 0;
+    uint32_t cycles_per_frame = 0;
+    const char* quirks_name = NULL; // NULL until given, as the catalog may pick one.
+    unsigned long stack_depth = STACK_DEPTH;
+    const char* manifest = NULL;
+    const char* golden = NULL;
+    uint32_t threads = 0;
+    bool lockstep = false;
+    uint64_t seed = time(NULL);
+    const char* record = NULL;
+    const char* replay = NULL;
+    bool trace_latency = false;
+    bool turbo = false;
+    const char* profile_name = NULL;
+    const char* trace_name = NULL;
+    const char* catalog = NULL;
+    bool print_hash = false;
+    const char* filename = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "-g") == 0) {
+            debug = 1;
+        } else if(strcmp(argv[i], "--headless") == 0) {
+            headless = 1;
+        } else if(strcmp(argv[i], "--threaded") == 0) {
+            engine = ENGINE_THREADED;
+        } else if(strcmp(argv[i], "--jit") == 0) {
+            engine = ENGINE_JIT;
+        } else if(strcmp(argv[i], "--cycles") == 0 && i + 1 < argc) {
+            cycles = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--cycles-per-frame") == 0 && i + 1 < argc) {
+            cycles_per_frame = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--quirks") == 0 && i + 1 < argc) {
+            quirks_name = argv[++i];
+        } else if(strcmp(argv[i], "--stack-depth") == 0 && i + 1 < argc) {
+            stack_depth = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--sizes") == 0) {
+            dump_sizes(stdout);
+            return EXIT_SUCCESS;
+        } else if(strcmp(argv[i], "--batch") == 0 && i + 1 < argc) {
+            manifest = argv[++i];
+        } else if(strcmp(argv[i], "--check") == 0 && i + 1 < argc) {
+            golden = argv[++i];
+        } else if(strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = strtoul(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--lockstep") == 0) {
+            lockstep = true;
+        } else if(strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoull(argv[++i], NULL, 0);
+        } else if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if(strcmp(argv[i], "--latency") == 0) {
+            trace_latency = true;
+        } else if(strcmp(argv[i], "--turbo") == 0) {
+            turbo = true;
+        } else if(strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+            profile_name = argv[++i];
+        } else if(strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_name = argv[++i];
+        } else if(strcmp(argv[i], "--catalog") == 0 && i + 1 < argc) {
+            catalog = argv[++i];
+        } else if(strcmp(argv[i], "--hash") == 0) {
+            print_hash = true;
+        } else {
+            filename = argv[i];
+        }
+    }
+#ifdef CHIP8_HEADLESS
+    headless = 1;
+#endif
+
+    uint8_t quirks;
+    if(!parse_quirks(quirks_name != NULL ? quirks_name : DEFAULT_QUIRKS, &quirks)) {
+        fprintf(stderr, "Unknown quirk profile '%s'\n", quirks_name);
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    if(stack_depth == 0 || stack_depth > STACK_MAX_DEPTH) {
+        fprintf(stderr, "The stack depth must be from 1 to %d\n", STACK_MAX_DEPTH);
+        return EXIT_FAILURE;
+    }
+
+    if(manifest != NULL || golden != NULL) {
+        struct batch_options options = {
+            .quirks = quirks,
+            .stack_depth = stack_depth,
+            .engine = engine,
+            .cycles_per_frame = cycles_per_frame,
+            .threads = threads,
+            .lockstep = lockstep
+        };
+        int failed = manifest != NULL ? run_batch(manifest, &options, stdout) :
+            check_golden(golden, &options, stdout);
+        return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(filename == NULL) {
+        usage(stderr);
         return EXIT_SUCCESS;
     }
-    
-    int debug;
-    int fd;
-    if(strcmp(argv[1], "-g") == 0) {
-        debug = 1;
-        fd = open(argv[2], O_RDONLY);
-    } else {
-        debug = 0;
-        fd = open(argv[1], O_RDONLY);
+
+    if(profile_name != NULL && trace_name != NULL) {
+        fprintf(stderr, "Profiling and tracing cannot be done at once.\n");
+        return EXIT_FAILURE;
     }
 
-    if(fd < 0) {
-        fprintf(stderr, "Failure in reading '%s'\n", argv[1]);
-        fprintf(stderr, "Usage: ./chip8 <file>\n");
+    if(debug && (record != NULL || replay != NULL)) {
+        fprintf(stderr, "Movies cannot be recorded or replayed in the debugger.\n");
         return EXIT_FAILURE;
     }
 
-    struct interpreter interpreter = {0};
-    interpreter.program_counter = START_ADDRESS;
+    static struct interpreter interpreter;
+    if(!load_program(&interpreter, filename)) {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+    if(print_hash) {
+        printf("%016llx %s\n", (unsigned long long) interpreter.rom_hash, filename);
+        return EXIT_SUCCESS;
+    }
 
-    if(load_code(interpreter.memory, fd) < 0) {
-        fprintf(stderr, "Failure in reading from '%s'\n", argv[1]);
+    // what the command line leaves unsaid comes from the catalog.
+    struct catalog_entry entry;
+    int found = find_in_catalog(catalog != NULL ? catalog : CATALOG_FILE,
+            interpreter.rom_hash, &entry, catalog != NULL);
+    if(found < 0) {
         return EXIT_FAILURE;
     }
-    close(fd);
+    if(found) {
+        fprintf(stderr, "Found '%s' in the catalog\n", entry.name[0] != '\0' ? entry.name : filename);
+        if(entry.has_quirks && quirks_name == NULL) quirks = entry.quirks;
+        if(cycles_per_frame == 0) cycles_per_frame = entry.cycles_per_frame;
+    }
+
+    // a replay brings its own settings.
+    struct movie movie = {0};
+    if(replay != NULL) {
+        if(!replay_movie(&movie, replay, &interpreter.cycles)) {
+            return EXIT_FAILURE;
+        }
+        if(movie.header.rom_hash != interpreter.rom_hash) {
+            fprintf(stderr, "'%s' was not recorded with '%s'\n", replay, filename);
+            finish_movie(&movie);
+            return EXIT_FAILURE;
+        }
+        quirks = movie.header.quirks;
+        stack_depth = movie.header.stack_depth;
+        seed = movie.header.seed;
+    }
+    set_quirks(&interpreter, quirks);
+    set_stack_depth(&interpreter, stack_depth);
+    seed_random(&interpreter, seed);
 
-    initialize_font(interpreter.memory);
+    interpreter.engine = engine;
+    if(engine == ENGINE_JIT && (interpreter.jit = create_jit()) == NULL) {
+        fprintf(stderr, "The recompiler is not available here, interpreting instead.\n");
+        interpreter.engine = ENGINE_INTERPRETER;
+    }
 
+    static struct profile profile;
+    if(profile_name != NULL) {
+        init_profile(&profile);
+        interpreter.profile = &profile;
+    }
+    static struct trace trace;
+    if(trace_name != NULL) {
+        if(!open_trace(&trace, trace_name, TRACE_RECORDS)) {
+            return EXIT_FAILURE;
+        }
+        interpreter.trace = &trace;
+    }
+
+    struct scheduler scheduler;
+    init_scheduler(&scheduler, FREQUENCY);
+    if(cycles_per_frame != 0) {
+        set_cycles_per_frame(&scheduler, cycles_per_frame);
+    }
+
+    // unthrottled, so a replay doubles as a benchmark.
+    if(replay != NULL) {
+        init_scheduler(&scheduler, movie.header.frequency);
+        struct platform platform = movie_platform(&movie);
+        interpreter.platform = &platform;
+
+        uint64_t start = monotonic_ns();
+        if(movie.header.cycles != 0) {
+            run_headless(&interpreter, &scheduler, movie.header.cycles);
+        }
+        double seconds = (monotonic_ns() - start) / 1e9;
+
+        dump_display(stdout, &interpreter.display);
+        fprintf(stderr, "Replayed %llu cycles in %.3f s (%.1f million per second)\n",
+                (unsigned long long) interpreter.cycles, seconds,
+                seconds > 0 ? interpreter.cycles / seconds / 1e6 : 0.0);
+        finish_movie(&movie);
+        if(profile_name != NULL) write_profile(&profile, profile_name);
+        if(trace_name != NULL) close_trace(&trace);
+        destroy_jit(interpreter.jit);
+        return EXIT_SUCCESS;
+    }
+
+    struct movie_header header = {
+        .quirks = quirks,
+        .stack_depth = stack_depth,
+        .frequency = scheduler.frequency,
+        .seed = seed,
+        .rom_hash = interpreter.rom_hash
+    };
+    struct platform recording;
+
+    if(headless) {
+        if(trace_latency) {
+            fprintf(stderr, "There are no key events to trace without the window, ignoring --latency.\n");
+        }
+        if(turbo) {
+            fprintf(stderr, "Without the window it runs unthrottled anyway, ignoring --turbo.\n");
+        }
+        interpreter.platform = &headless_platform;
+        if(debug) {
+            debugger(&interpreter, &scheduler, false);
+            return EXIT_SUCCESS;
+        }
+
+        if(record != NULL) {
+            if(!record_movie(&movie, record, &header, interpreter.platform, &interpreter.cycles)) {
+                return EXIT_FAILURE;
+            }
+            recording = movie_platform(&movie);
+            interpreter.platform = &recording;
+        }
+
+        run_headless(&interpreter, &scheduler, cycles);
+        dump_display(stdout, &interpreter.display);
+        if(record != NULL) finish_movie(&movie);
+        if(profile_name != NULL) write_profile(&profile, profile_name);
+        if(trace_name != NULL) close_trace(&trace);
+        destroy_jit(interpreter.jit);
+        return EXIT_SUCCESS;
+    }
+
+#ifndef CHIP8_HEADLESS
     struct screen screen = {0};
     if(!init_screen(&screen)) {
         return EXIT_FAILURE;
     }
+    struct platform platform = screen_platform(&screen);
+    interpreter.platform = &platform;
+    if(found && entry.has_keymap) {
+        memcpy(screen.keymap, entry.keymap, sizeof(screen.keymap));
+    }
 
     if(debug) {
-        debugger(&interpreter, &screen);
+        debugger(&interpreter, &scheduler, !turbo);
         return EXIT_SUCCESS;
     }
 
-    clock_t cpu_clock = clock();
-    clock_t timer_clock = clock();
-
-    for(;;) {
-        if((double) (clock() - cpu_clock) < CYCLE_TIME * CLOCKS_PER_SEC) continue;
-        cpu_clock += CYCLE_TIME * CLOCKS_PER_SEC;
-
-        if(!handle_event()) break;
-        decode(&interpreter, fetch(&interpreter));
+    // a movie can't go back in time, so there is no rewinding while recording.
+    static struct rewind rewind;
+    if(record != NULL) {
+        if(!record_movie(&movie, record, &header, interpreter.platform, &interpreter.cycles)) {
+            destroy_screen(&screen);
+            return EXIT_FAILURE;
+        }
+        recording = movie_platform(&movie);
+        interpreter.platform = &recording;
+    } else if(!init_rewind(&rewind, &interpreter)) {
+        destroy_screen(&screen);
+        return EXIT_FAILURE;
+    }
 
-        if((double) (clock() - timer_clock) < TIMER_CYCLE_TIME * CLOCKS_PER_SEC) continue;
-        timer_clock += TIMER_CYCLE_TIME * CLOCKS_PER_SEC;
+    static struct latency latency;
+    if(trace_latency) {
+        init_latency(&latency);
+        interpreter.latency = &latency;
+        screen.latency = &latency;
+    }
 
-        update_internals(&interpreter, &screen);
+    // with --turbo, or while tab is held, frames run back to back. Timers
+    // still tick every emulated frame, but only one frame in TURBO_FRAME_SKIP,
+    // and no more than one per refresh of the display, is drawn and played,
+    // and events are only polled then. Only those are kept for rewinding too,
+    // so the history still covers REWIND_SECONDS of what was on screen.
+    uint32_t skipped = 0; // frames run since the last one shown.
+    uint64_t shown = 0; // when that was.
+    init_scheduler(&scheduler, scheduler.frequency);
+    for(;;) {
+        bool fast = turbo || screen.fast_forwarding;
+        bool show = !fast || (skipped + 1 >= TURBO_FRAME_SKIP &&
+                monotonic_ns() - shown >= screen.refresh_ns);
+        if(show && !poll_platform(&interpreter)) break;
+        if(show && screen.rewinding && rewind.buffer != NULL) {
+            // one frame back per frame, in silence, until the history runs out.
+            if(rewind_snapshot(&rewind, &interpreter)) {
+                platform.draw_display(platform.userdata, &interpreter.display);
+                interpreter.dirty_rows = 0;
+            }
+            platform.play_sound(platform.userdata, 0, NULL);
+            wait_for_frame(&scheduler);
+            continue;
+        }
+        run_cycles(&interpreter, next_batch(&scheduler));
+        if(show) {
+            update_internals(&interpreter);
+            skipped = 0;
+            shown = monotonic_ns();
+        } else {
+            tick_timers(&interpreter);
+            skipped++;
+        }
+        if(show && rewind.buffer != NULL) save_snapshot(&rewind, &interpreter);
+        if(!fast) {
+            wait_for_frame(&scheduler);
+        } else if(show) {
+            // fast-forwarding only stops on a frame shown, so pace from then.
+            scheduler.deadline = shown;
+        }
     }
 
+    if(trace_latency) report_latency(stderr, &latency);
+    if(profile_name != NULL) write_profile(&profile, profile_name);
+    if(trace_name != NULL) close_trace(&trace);
+    if(record != NULL) finish_movie(&movie);
+    destroy_rewind(&rewind);
     destroy_screen(&screen);
+    destroy_jit(interpreter.jit);
+#endif
     return 0;
 }
-
@@ -1,14 +1,21 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: 01/01/26
+ * Date modified: 10/17/26
  **/
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "settings.h"
 #include "debug.h"
 #include "memory.h"
-#include "screen.h"
+#include "interpret.h"
+#include "platform.h"
+#include "scheduler.h"
 
 void dump_memory(FILE* fp, uint8_t* memory) {
     fprintf(fp, "\t== MEMORY ==");
@@ -22,13 +29,13 @@ void dump_memory(FILE* fp, uint8_t* memory) {
     fprintf(fp, "\n\t== MEMORY END ==\n");
 }
 
-void dump_stack(FILE* fp, struct stack* stack) {
+void dump_stack(FILE* fp, const uint16_t* stack, uint8_t pointer) {
     fprintf(fp, "\t== STACK ==");
-    for(uint32_t i = 0; i < stack->pointer; i++) {
+    for(uint32_t i = 0; i < pointer; i++) {
         if((i & 0xF) == 0) {
             fprintf(fp, "\n%4d (%03x). ", i, i);
         }
-        fprintf(fp, "[%04X]", stack->data[i]);
+        fprintf(fp, "[%04X]", stack[i]);
     }
     fprintf(fp, "\n\t== STACK END==\n");
 }
@@ -44,22 +51,428 @@ void dump_registers(FILE* fp, uint8_t* registers) {
     fprintf(fp, "\n\t== REGISTERS END ==\n");
 }
 
-void dump_display(FILE *fp, bool display[][WIDTH]) {
+// 'X' for the first plane, 'o' for the second, '#' for both.
+void dump_display(FILE *fp, const struct display* display) {
+    static const char pixels[1 << DISPLAY_PLANES] = {' ', 'X', 'o', '#'};
     fprintf(fp, "\t== DISPLAY ==\n");
-    for(int i = 0; i < HEIGHT; i++) {
+    for(int i = 0; i < DISPLAY_HEIGHT(display); i++) {
         fprintf(fp, "|");
-        for(int j = 0; j < WIDTH; j++) {
-            fprintf(fp, "%c", display[i][j] ? 'X' : ' ');
+        for(int j = 0; j < DISPLAY_WIDTH(display); j++) {
+            int pixel = DISPLAY_PIXEL(display->planes[0], i, j) |
+                DISPLAY_PIXEL(display->planes[1], i, j) << 1;
+            fprintf(fp, "%c", pixels[pixel]);
         }
         fprintf(fp, "|\n");
     }
     fprintf(fp, "\t== DISPLAY END ==\n");
 }
 
+#define FNV_OFFSET 0xCBF29CE484222325ull
+#define FNV_PRIME 0x100000001B3ull
+
+static uint64_t hash_plane(uint64_t hash, const struct display* display, uint8_t plane) {
+    uint32_t words = display->hires ? ROW_WORDS : 1;
+    for(uint32_t row = 0; row < (uint32_t) DISPLAY_HEIGHT(display); row++) {
+        for(uint32_t word = 0; word < words; word++) {
+            for(int shift = 56; shift >= 0; shift -= 8) {
+                hash ^= (display->planes[plane][row][word] >> shift) & 0xFF;
+                hash *= FNV_PRIME;
+            }
+        }
+    }
+    return hash;
+}
+
+/**
+ * 64-bit FNV-1a over the display, row by row from the left, so two runs
+ * can be compared without keeping whole framebuffers around. The second
+ * plane only counts once something is drawn on it, so a CHIP-8 screen
+ * hashes the same as it always has.
+ **/
+uint64_t hash_display(const struct display* display) {
+    uint64_t hash = hash_plane(FNV_OFFSET, display, 0);
+    static const uint64_t blank[HIRES_HEIGHT][ROW_WORDS];
+    if(memcmp(display->planes[1], blank, sizeof(blank)) != 0) {
+        hash = hash_plane(hash, display, 1);
+    }
+    return hash;
+}
+
+// 64-bit FNV-1a, e.g. to tell ROMs apart.
+uint64_t hash_bytes(const uint8_t* bytes, size_t length) {
+    return hash_more(FNV_OFFSET, bytes, length);
+}
+
+uint64_t hash_more(uint64_t hash, const uint8_t* bytes, size_t length) {
+    for(size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+#undef FNV_PRIME
+#undef FNV_OFFSET
+
+#define FIELD_SIZE(field) sizeof(((struct interpreter*) NULL)->field)
+
+// what one interpreter costs in this build, e.g. to see how many fit in cache.
+void dump_sizes(FILE* fp) {
+    size_t hot = offsetof(struct interpreter, jit);
+    size_t parts = hot + FIELD_SIZE(stack) + FIELD_SIZE(display) +
+        FIELD_SIZE(memory) + FIELD_SIZE(cache);
+    fprintf(fp, "struct interpreter: %zu bytes, aligned to %zu\n",
+            sizeof(struct interpreter), _Alignof(struct interpreter));
+    fprintf(fp, "\thot state:    %6zu (registers, PC, I, timers, stack pointer, ...)\n", hot);
+    fprintf(fp, "\tstack:        %6zu (%d levels at most)\n", FIELD_SIZE(stack), STACK_MAX_DEPTH);
+    fprintf(fp, "\tdisplay:      %6zu\n", FIELD_SIZE(display));
+    fprintf(fp, "\tmemory:       %6zu\n", FIELD_SIZE(memory));
+    fprintf(fp, "\tdecode cache: %6zu (%zu bytes per instruction)\n",
+            FIELD_SIZE(cache), sizeof(struct operation));
+    fprintf(fp, "\tthe rest:     %6zu\n", sizeof(struct interpreter) - parts);
+}
+
+#undef FIELD_SIZE
+
+/**
+ * What stops the debugger while it runs. Addresses are bitmaps, bit
+ * (a & 63) of word a / 64 for address a, so checking one is a single bit
+ * test. Nothing is checked at all while nothing is set.
+ **/
+#define MAP_WORDS (MEMORY_SIZE / 64)
+#define MAX_CONDITIONS 8
+#define INDEX_REGISTER REGISTER_SIZE // what a condition on I uses for its register.
+
+enum comparison {
+    COMPARE_EQUAL,
+    COMPARE_NOT_EQUAL,
+    COMPARE_LESS,
+    COMPARE_LESS_EQUAL,
+    COMPARE_GREATER,
+    COMPARE_GREATER_EQUAL,
+    COMPARE_COUNT
+};
+
+static const char* comparisons[COMPARE_COUNT] = {
+    [COMPARE_EQUAL] = "==",
+    [COMPARE_NOT_EQUAL] = "!=",
+    [COMPARE_LESS] = "<",
+    [COMPARE_LESS_EQUAL] = "<=",
+    [COMPARE_GREATER] = ">",
+    [COMPARE_GREATER_EQUAL] = ">="
+};
+
+// breaks when `reg` compared with `value` turns true.
+struct condition {
+    uint8_t reg; // V0 to VF, or INDEX_REGISTER.
+    uint8_t comparison; // an enum comparison.
+    uint16_t value;
+    bool held; // as of the last instruction.
+};
+
+struct breakpoints {
+    uint64_t pc[MAP_WORDS]; // stop before running the instruction here.
+    uint64_t read[MAP_WORDS]; // stop before an instruction reads here.
+    uint64_t write[MAP_WORDS]; // stop before an instruction writes here.
+    struct condition conditions[MAX_CONDITIONS];
+    uint8_t condition_count;
+};
+
+enum stop {
+    STOP_DONE, // ran as many instructions as asked.
+    STOP_BREAKPOINT,
+    STOP_READ,
+    STOP_WRITE,
+    STOP_CONDITION,
+    STOP_INTERRUPTED, // ctrl-C.
+    STOP_QUIT // the platform wants to stop.
+};
+
+static volatile sig_atomic_t interrupted = 0;
+
+static void interrupt(int signal) {
+    (void) signal;
+    interrupted = 1;
+}
+
+static bool test_bit(const uint64_t* map, uint16_t address) {
+    address &= MEMORY_SIZE - 1;
+    return (map[address >> 6] >> (address & 63)) & 0x01;
+}
+
+static bool any_bit(const uint64_t* map) {
+    for(uint32_t i = 0; i < MAP_WORDS; i++) {
+        if(map[i] != 0) return true;
+    }
+    return false;
+}
+
+static void set_bits(uint64_t* map, uint16_t first, uint16_t last) {
+    for(uint32_t address = first; address <= last && address < MEMORY_SIZE; address++) {
+        map[address >> 6] |= 1ull << (address & 63);
+    }
+}
+
+static bool test_condition(const struct interpreter* interpreter, const struct condition* condition) {
+    uint16_t value = condition->reg == INDEX_REGISTER ? interpreter->index_register :
+        interpreter->registers[condition->reg];
+    switch(condition->comparison) {
+        case COMPARE_EQUAL: return value == condition->value;
+        case COMPARE_NOT_EQUAL: return value != condition->value;
+        case COMPARE_LESS: return value < condition->value;
+        case COMPARE_LESS_EQUAL: return value <= condition->value;
+        case COMPARE_GREATER: return value > condition->value;
+        default: return value >= condition->value;
+    }
+}
+
+// returns the first condition to turn true, or -1.
+static int check_conditions(const struct interpreter* interpreter, struct breakpoints* breakpoints) {
+    int turned = -1;
+    for(uint8_t i = 0; i < breakpoints->condition_count; i++) {
+        struct condition* condition = &breakpoints->conditions[i];
+        bool held = test_condition(interpreter, condition);
+        if(held && !condition->held && turned < 0) turned = i;
+        condition->held = held;
+    }
+    return turned;
+}
+
+/**
+ * Which memory the next instruction reads or writes, as `count` bytes
+ * from `*first` (wrapping around memory). Fetching it doesn't count.
+ **/
+static uint8_t memory_access(struct interpreter* interpreter, uint16_t* first, bool* writes) {
+    uint16_t address = interpreter->program_counter;
+    uint16_t instruction = (interpreter->memory[address & (MEMORY_SIZE - 1)] << 8) |
+        interpreter->memory[(address + 1) & (MEMORY_SIZE - 1)];
+    struct operation op;
+    interpreter->decode_operation(instruction, &op);
+    *first = interpreter->index_register;
+    *writes = false;
+    switch(op.handler) {
+        case OP_DRAW:
+            // a sprite for each plane drawn to, one after the other.
+            return (OP_N(&op) != 0 ? OP_N(&op) : 32) * __builtin_popcount(interpreter->planes);
+        case OP_LOAD:
+        case OP_LOAD_INCREMENT:
+        case OP_LOAD_INCREMENT_X:
+            return OP_X(&op) + 1;
+        case OP_AUDIO:
+            return 16;
+        case OP_DECIMAL:
+            *writes = true;
+            return 3;
+        case OP_STORE:
+        case OP_STORE_INCREMENT:
+        case OP_STORE_INCREMENT_X:
+            *writes = true;
+            return OP_X(&op) + 1;
+        case OP_LOAD_RANGE:
+            return (OP_X(&op) <= OP_Y(&op) ? OP_Y(&op) - OP_X(&op) : OP_X(&op) - OP_Y(&op)) + 1;
+        case OP_SAVE_RANGE:
+            *writes = true;
+            return (OP_X(&op) <= OP_Y(&op) ? OP_Y(&op) - OP_X(&op) : OP_X(&op) - OP_Y(&op)) + 1;
+        default:
+            return 0;
+    }
+}
+
+// returns STOP_READ or STOP_WRITE with the address in `*hit`, or STOP_DONE.
+static enum stop check_watches(struct interpreter* interpreter,
+        const struct breakpoints* breakpoints, uint16_t* hit) {
+    uint16_t first;
+    bool writes;
+    uint8_t count = memory_access(interpreter, &first, &writes);
+    const uint64_t* map = writes ? breakpoints->write : breakpoints->read;
+    for(uint8_t i = 0; i < count; i++) {
+        uint16_t address = (first + i) & (MEMORY_SIZE - 1);
+        if(test_bit(map, address)) {
+            *hit = address;
+            return writes ? STOP_WRITE : STOP_READ;
+        }
+    }
+    return STOP_DONE;
+}
+
+/**
+ * Runs `cycles` instructions one at a time, checking before each for
+ * breakpoints and watchpoints, and after each for conditions.
+ * The first is not checked with `resuming`, so as to get past where the
+ * last run stopped.
+ **/
+static enum stop run_checked(struct interpreter* interpreter, struct breakpoints* breakpoints,
+        uint32_t cycles, bool resuming, uint32_t* ran, uint16_t* hit) {
+    bool watching = any_bit(breakpoints->read) || any_bit(breakpoints->write);
+    for(*ran = 0; *ran < cycles; (*ran)++) {
+        if(!resuming || *ran != 0) {
+            if(test_bit(breakpoints->pc, interpreter->program_counter)) return STOP_BREAKPOINT;
+            if(watching) {
+                enum stop stop = check_watches(interpreter, breakpoints, hit);
+                if(stop != STOP_DONE) return stop;
+            }
+        }
+        run_cycles(interpreter, 1);
+        if(breakpoints->condition_count != 0) {
+            int turned = check_conditions(interpreter, breakpoints);
+            if(turned >= 0) {
+                (*ran)++;
+                *hit = turned;
+                return STOP_CONDITION;
+            }
+        }
+    }
+    return STOP_DONE;
+}
+
+/**
+ * Runs until something in `breakpoints` stops it, ctrl-C, or `cycles`
+ * instructions (0 for no limit). With `frames`, it runs as on screen:
+ * a frame's instructions, then the timers and display, waiting out each
+ * frame if `realtime`. With nothing to check, it is just run_cycles().
+ **/
+static enum stop debug_run(struct interpreter* interpreter, struct breakpoints* breakpoints,
+        struct scheduler* scheduler, uint64_t cycles, bool frames, bool realtime,
+        uint64_t* executed, uint16_t* hit) {
+    bool checked = breakpoints->condition_count != 0 || any_bit(breakpoints->pc) ||
+        any_bit(breakpoints->read) || any_bit(breakpoints->write);
+    for(uint8_t i = 0; i < breakpoints->condition_count; i++) {
+        breakpoints->conditions[i].held = test_condition(interpreter, &breakpoints->conditions[i]);
+    }
+
+    interrupted = 0;
+    void (*previous)(int) = signal(SIGINT, interrupt);
+    if(frames) init_scheduler(scheduler, scheduler->frequency);
+    enum stop stop = STOP_DONE;
+    *executed = 0;
+    while(cycles == 0 || *executed < cycles) {
+        // without frames, in chunks only so that ctrl-C is noticed.
+        uint32_t batch = frames ? next_batch(scheduler) : 1 << 16;
+        if(cycles != 0 && cycles - *executed < batch) {
+            batch = cycles - *executed;
+        }
+        uint32_t ran = batch;
+        if(checked) {
+            stop = run_checked(interpreter, breakpoints, batch, *executed == 0, &ran, hit);
+        } else {
+            run_cycles(interpreter, batch);
+        }
+        *executed += ran;
+        if(stop != STOP_DONE) break;
+        if(interrupted) {
+            stop = STOP_INTERRUPTED;
+            break;
+        }
+
+        if(frames) {
+            if(!poll_platform(interpreter)) {
+                stop = STOP_QUIT;
+                break;
+            }
+            update_internals(interpreter);
+            if(realtime) wait_for_frame(scheduler);
+        }
+    }
+    signal(SIGINT, previous);
+    return stop;
+}
+
+static void print_map(FILE* fp, const char* name, const uint64_t* map) {
+    for(uint32_t address = 0; address < MEMORY_SIZE; address++) {
+        if(!test_bit(map, address)) continue;
+        uint32_t last = address;
+        while(last + 1 < MEMORY_SIZE && test_bit(map, last + 1)) last++;
+        if(last == address) {
+            fprintf(fp, "\t%s %03X\n", name, address);
+        } else {
+            fprintf(fp, "\t%s %03X-%03X\n", name, address, last);
+        }
+        address = last;
+    }
+}
+
+static void print_condition(FILE* fp, const struct condition* condition) {
+    if(condition->reg == INDEX_REGISTER) {
+        fprintf(fp, "I %s %03X", comparisons[condition->comparison], condition->value);
+    } else {
+        fprintf(fp, "V%X %s %02X", condition->reg, comparisons[condition->comparison],
+                condition->value);
+    }
+}
+
+static void list_breakpoints(FILE* fp, const struct breakpoints* breakpoints) {
+    print_map(fp, "break at", breakpoints->pc);
+    print_map(fp, "watch reads of", breakpoints->read);
+    print_map(fp, "watch writes to", breakpoints->write);
+    for(uint8_t i = 0; i < breakpoints->condition_count; i++) {
+        fprintf(fp, "\tbreak when ");
+        print_condition(fp, &breakpoints->conditions[i]);
+        fprintf(fp, "\n");
+    }
+}
+
+static void report_stop(FILE* fp, struct interpreter* interpreter,
+        const struct breakpoints* breakpoints, enum stop stop, uint64_t executed, uint16_t hit) {
+    uint16_t pc = interpreter->program_counter & (MEMORY_SIZE - 1);
+    uint16_t instruction = (interpreter->memory[pc] << 8) |
+        interpreter->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+    switch(stop) {
+        case STOP_BREAKPOINT:
+            fprintf(fp, "Breakpoint");
+            break;
+        case STOP_READ:
+            fprintf(fp, "Read of %03X", hit);
+            break;
+        case STOP_WRITE:
+            fprintf(fp, "Write to %03X", hit);
+            break;
+        case STOP_CONDITION:
+            print_condition(fp, &breakpoints->conditions[hit]);
+            break;
+        case STOP_INTERRUPTED:
+            fprintf(fp, "Interrupted");
+            break;
+        default:
+            fprintf(fp, "Stopped");
+            break;
+    }
+    fprintf(fp, " after %llu instructions, at %03X: %04X\n",
+            (unsigned long long) executed, pc, instruction);
+}
+
+// parses `V3 == 0A` or `I >= 300`.
+static bool parse_condition(const char* arguments, struct condition* condition) {
+    char name[4];
+    char comparison[3];
+    unsigned int value;
+    if(sscanf(arguments, " %3s %2s %x", name, comparison, &value) != 3) return false;
+
+    if((name[0] == 'I' || name[0] == 'i') && name[1] == '\0') {
+        condition->reg = INDEX_REGISTER;
+    } else if((name[0] == 'V' || name[0] == 'v') && name[1] != '\0' && name[2] == '\0') {
+        char* end;
+        condition->reg = strtoul(name + 1, &end, 16);
+        if(*end != '\0') return false;
+    } else {
+        return false;
+    }
+    for(condition->comparison = 0; condition->comparison < COMPARE_COUNT; condition->comparison++) {
+        if(strcmp(comparisons[condition->comparison], comparison) == 0) break;
+    }
+    condition->value = value;
+    return condition->comparison < COMPARE_COUNT;
+}
+
 void menu(FILE* fp) {
     fprintf(fp, "CHIP-8 DEBUGGER\n");
     fprintf(fp, "\th: help! (see this menu)\n");
-    fprintf(fp, "\tn: fetch, decode, and execute next instruction\n");
+    fprintf(fp, "\tn [N]: fetch, decode, and execute the next N instructions (default 1)\n");
+    fprintf(fp, "\tc: continue at full speed, with timers, until a break or ctrl-C\n");
+    fprintf(fp, "\tb ADDR: set or clear a breakpoint at ADDR\n");
+    fprintf(fp, "\tw ADDR[-ADDR] [r|w]: break before memory there is read and/or written\n");
+    fprintf(fp, "\tx REG OP VALUE: break once e.g. V3 == 0A or I >= 300 turns true\n");
+    fprintf(fp, "\tl: list breakpoints, watchpoints and conditions\n");
+    fprintf(fp, "\tk: clear them all\n");
     fprintf(fp, "\t1: move time forward 1 step, i.e. update timers and refresh screen\n");
     fprintf(fp, "\ti: see index register contents\n");
     fprintf(fp, "\tp: see program counter contents\n");
@@ -70,24 +483,101 @@ void menu(FILE* fp) {
     fprintf(fp, "\to: see sound timer\n");
     fprintf(fp, "\tt: see delay timer\n");
     fprintf(fp, "\tq: quit\n");
+    fprintf(fp, "Addresses and values are in hex.\n");
 }
 
-void debugger(struct interpreter* interpreter, struct screen* screen) {
-    uint16_t instruction = 0x0000;
+/**
+ * @param   realtime    whether `c` runs at the speed of the game, for playing
+ *                      it up to a bug; otherwise as fast as the host can
+ **/
+void debugger(struct interpreter* interpreter, struct scheduler* scheduler, bool realtime) {
+    static struct breakpoints breakpoints;
+    char line[128];
     for(;;) {
-        if(!handle_event()) break;
+        if(!poll_platform(interpreter)) break;
         fprintf(stdout, ">> ");
-        switch(fgetc(stdin)) {
+        fflush(stdout);
+        if(fgets(line, sizeof(line), stdin) == NULL) break;
+        char command = '\0';
+        int skip = 0;
+        sscanf(line, " %c%n", &command, &skip);
+        const char* arguments = line + skip;
+
+        uint64_t executed;
+        uint16_t hit = 0;
+        enum stop stop;
+        unsigned int first;
+        unsigned int last;
+        char kind[3] = "rw";
+        struct condition condition = {0};
+        switch(command) {
             case 'h':
                 menu(stdout);
                 break;
-            case 'n':
-                instruction = fetch(interpreter);
-                decode(interpreter, instruction);
-                fprintf(stdout, "Performed instruction: %04X\n", instruction);
+            case 'n': {
+                unsigned long long count = 1;
+                sscanf(arguments, "%llu", &count);
+                if(count == 0) break;
+                uint16_t pc = interpreter->program_counter & (MEMORY_SIZE - 1);
+                uint16_t instruction = (interpreter->memory[pc] << 8) |
+                    interpreter->memory[(pc + 1) & (MEMORY_SIZE - 1)];
+                stop = debug_run(interpreter, &breakpoints, scheduler, count, false, false,
+                        &executed, &hit);
+                if(count == 1 && executed == 1) {
+                    fprintf(stdout, "Performed instruction: %04X\n", instruction);
+                } else {
+                    report_stop(stdout, interpreter, &breakpoints, stop, executed, hit);
+                }
+                break;
+            }
+            case 'c':
+                stop = debug_run(interpreter, &breakpoints, scheduler, 0, true, realtime,
+                        &executed, &hit);
+                if(stop == STOP_QUIT) return;
+                report_stop(stdout, interpreter, &breakpoints, stop, executed, hit);
+                break;
+            case 'b':
+                if(sscanf(arguments, "%x", &first) != 1 || first >= MEMORY_SIZE) {
+                    fprintf(stdout, "Usage: b ADDR\n");
+                    break;
+                }
+                breakpoints.pc[first >> 6] ^= 1ull << (first & 63);
+                fprintf(stdout, "%s breakpoint at %03X\n",
+                        test_bit(breakpoints.pc, first) ? "Set" : "Cleared", first);
+                break;
+            case 'w': {
+                int fields = sscanf(arguments, "%x-%x %2s", &first, &last, kind);
+                if(fields < 2) {
+                    last = first;
+                    fields = sscanf(arguments, "%x %2s", &first, kind);
+                }
+                if(fields < 1 || first >= MEMORY_SIZE || last < first) {
+                    fprintf(stdout, "Usage: w ADDR[-ADDR] [r|w]\n");
+                    break;
+                }
+                if(strchr(kind, 'r') != NULL) set_bits(breakpoints.read, first, last);
+                if(strchr(kind, 'w') != NULL) set_bits(breakpoints.write, first, last);
+                list_breakpoints(stdout, &breakpoints);
+                break;
+            }
+            case 'x':
+                if(!parse_condition(arguments, &condition) || condition.reg > INDEX_REGISTER) {
+                    fprintf(stdout, "Usage: x V0-VF|I ==|!=|<|<=|>|>= VALUE\n");
+                } else if(breakpoints.condition_count == MAX_CONDITIONS) {
+                    fprintf(stdout, "At most %d conditions; clear them with k\n", MAX_CONDITIONS);
+                } else {
+                    breakpoints.conditions[breakpoints.condition_count++] = condition;
+                    list_breakpoints(stdout, &breakpoints);
+                }
+                break;
+            case 'l':
+                list_breakpoints(stdout, &breakpoints);
+                break;
+            case 'k':
+                memset(&breakpoints, 0, sizeof(breakpoints));
                 break;
             case '1':
-                update_internals(interpreter, screen);
+                update_internals(interpreter);
                 break;
             case 'i':
                 fprintf(stdout, "I: %u (%04X)\n", interpreter->index_register, 
@@ -101,13 +591,13 @@ void debugger(struct interpreter* interpreter, struct screen* screen) {
                 dump_memory(stdout, interpreter->memory);
                 break;
             case 'd':
-                dump_display(stdout, interpreter->display);
+                dump_display(stdout, &interpreter->display);
                 break;
             case 'r':
                 dump_registers(stdout, interpreter->registers);
                 break;
             case 's':
-                dump_stack(stdout, &interpreter->stack);
+                dump_stack(stdout, interpreter->stack, interpreter->stack_pointer);
                 break;
             case 'o':
                 fprintf(stdout, "Sound timer: %u (%02X)\n", interpreter->sound_timer,
@@ -120,8 +610,9 @@ void debugger(struct interpreter* interpreter, struct screen* screen) {
             case 'q':
                 return;
         }
-        // clear stdin.
-        for(char c = fgetc(stdin); c != '\n' && c != EOF; c = fgetc(stdin));
     }
 }
 
+#undef INDEX_REGISTER
+#undef MAX_CONDITIONS
+#undef MAP_WORDS
@@ -0,0 +1,65 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "settings.h"
+#include "platform.h"
+
+/**
+ * Writes one texel per pixel into `pixels`, whose rows start `pitch` bytes
+ * apart, a word of each plane at a time.
+ **/
+void expand_display(const struct display* display, void* pixels, int pitch) {
+    static const uint32_t colors[4] = {OFF_COLOR, ON_COLOR, PLANE_2_COLOR, BOTH_PLANES_COLOR};
+    uint32_t width = DISPLAY_WIDTH(display);
+    uint32_t height = DISPLAY_HEIGHT(display);
+    for(uint32_t i = 0; i < height; i++) {
+        uint32_t* texels = (uint32_t*) ((uint8_t*) pixels + i * pitch);
+        for(uint32_t word = 0; word < width / 64; word++) {
+            uint64_t first = display->planes[0][i][word];
+            uint64_t second = display->planes[1][i][word];
+            if(second == 0) {
+                // the usual case, which the compiler can vectorize.
+                for(uint32_t j = 0; j < 64; j++) {
+                    texels[word * 64 + j] = (first >> (63 - j)) & 0x01 ? ON_COLOR : OFF_COLOR;
+                }
+                continue;
+            }
+            for(uint32_t j = 0; j < 64; j++) {
+                uint32_t shift = 63 - j;
+                texels[word * 64 + j] = colors[((first >> shift) & 0x01) | (((second >> shift) & 0x01) << 1)];
+            }
+        }
+    }
+}
+
+static bool headless_handle_events(void* userdata) {
+    (void) userdata;
+    return true;
+}
+
+static uint16_t headless_read_keys(void* userdata) {
+    (void) userdata;
+    return 0;
+}
+
+static void headless_draw_display(void* userdata, const struct display* display) {
+    (void) userdata, (void) display;
+}
+
+static void headless_play_sound(void* userdata, uint8_t timer_value,
+        const struct sound_pattern* pattern) {
+    (void) userdata, (void) timer_value, (void) pattern;
+}
+
+const struct platform headless_platform = {
+    .userdata = NULL,
+    .handle_events = headless_handle_events,
+    .read_keys = headless_read_keys,
+    .draw_display = headless_draw_display,
+    .play_sound = headless_play_sound
+};
@@ -1,14 +1,25 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: 01/02/26
+ * Date modified: 10/17/26
  **/
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "settings.h"
 #include "memory.h"
 #include "interpret.h"
-#include "screen.h"
+#include "platform.h"
+#include "latency.h"
+#include "profile.h"
+#include "trace.h"
+#include "scheduler.h"
+#include "jit.h"
+#include "debug.h"
 
 #define NIBBLE_1_BYTE(byte) (((byte) >> 4) & 0x0F)
 #define NIBBLE_2_BYTE(byte) ((byte) & 0x0F)
@@ -27,313 +38,1343 @@
 #define CLEAR_BIT(bytes, n)  (~(0x01 << (n)) & (bytes))
 #define TOGGLE_BIT(bytes, n) ((0x01 << (n)) ^ (bytes))
 
+// Addresses wrap around the end of memory rather than run off it.
+#define READ_MEMORY(interpreter, address) \
+    ((interpreter)->memory[(address) & (MEMORY_SIZE - 1)])
+
+/**
+ * Resets the interpreter to power-on state with `filename` loaded at
+ * START_ADDRESS, and its hash in `rom_hash`. The platform, quirks and
+ * engine still need setting. A ROM too big for memory is cut short.
+ * @return  false if the file cannot be read, or is empty.
+ **/
+bool load_program(struct interpreter* interpreter, const char* filename) {
+    memset(interpreter, 0, sizeof(*interpreter));
+    interpreter->program_counter = START_ADDRESS;
+    interpreter->stack_depth = STACK_DEPTH;
+    interpreter->sound.pitch = DEFAULT_PITCH;
+    interpreter->planes = 0x01;
+    interpreter->skip_idle = true;
+    seed_random(interpreter, 0);
+
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+        fprintf(stderr, "Failure in reading '%s'\n", filename);
+        return false;
+    }
+    // files are mapped, anything else (e.g. a pipe) is read.
+    struct stat status;
+    size_t size = 0;
+    ssize_t loaded = -1;
+    if(fstat(fd, &status) == 0 && S_ISREG(status.st_mode) && status.st_size > 0) {
+        size = status.st_size;
+        loaded = map_code(interpreter->memory, fd, size, &interpreter->rom_hash);
+    }
+    if(loaded < 0) {
+        loaded = load_code(interpreter->memory, fd, &size, &interpreter->rom_hash);
+    }
+    close(fd);
+    if(loaded < 0) {
+        fprintf(stderr, "Failure in reading from '%s'\n", filename);
+        return false;
+    }
+    if(loaded == 0) {
+        fprintf(stderr, "'%s' is empty\n", filename);
+        return false;
+    }
+    if(size > (size_t) loaded) {
+        fprintf(stderr, "'%s' is too big for memory, only its first %zd bytes are loaded\n",
+                filename, loaded);
+    }
+
+    initialize_font(interpreter->memory);
+    return true;
+}
+
+/**
+ * Every interpreter has its own random numbers, so runs with the same seed
+ * come out the same no matter what else is running alongside them.
+ * The seed goes through splitmix64 first so that nearby seeds give
+ * unrelated sequences (and the state is never the stuck value 0).
+ **/
+void seed_random(struct interpreter* interpreter, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    interpreter->random_state = z != 0 ? z : 1;
+}
+
+// xorshift64*, taking the top (best mixed) byte.
+static uint8_t random_byte(struct interpreter* interpreter) {
+    uint64_t x = interpreter->random_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    interpreter->random_state = x;
+    return (x * 0x2545F4914F6CDD1Dull) >> 56;
+}
+
 uint16_t fetch(struct interpreter* interpreter) {
-    uint8_t b1 = interpreter->memory[interpreter->program_counter++];
-    uint8_t b2 = interpreter->memory[interpreter->program_counter++];
+    uint8_t b1 = READ_MEMORY(interpreter, interpreter->program_counter++);
+    uint8_t b2 = READ_MEMORY(interpreter, interpreter->program_counter++);
     return (b1 << 8) | b2;
 }
 
-void update_internals(struct interpreter* interpreter, struct screen* screen) {
+// 4 for XO-CHIP's F000 NNNN, which a skip has to skip whole, otherwise 2.
+uint8_t instruction_length(const struct interpreter* interpreter, uint16_t address) {
+    return READ_MEMORY(interpreter, address) == 0xF0 &&
+        READ_MEMORY(interpreter, address + 1) == 0x00 ? 4 : 2;
+}
+
+/**
+ * Lets the platform handle its events, then latches the keypad, which the
+ * program sees until the next call. Called once a frame, between batches.
+ * @return  false when the host wants emulation to stop.
+ **/
+bool poll_platform(struct interpreter* interpreter) {
+    const struct platform* platform = interpreter->platform;
+    if(!platform->handle_events(platform->userdata)) return false;
+    interpreter->keys = platform->read_keys(platform->userdata);
+    return true;
+}
+
+/**
+ * The end of a frame without showing it: timers tick, but nothing is drawn
+ * or played. The rows drawn stay dirty until the next update_internals().
+ **/
+void tick_timers(struct interpreter* interpreter) {
     if(interpreter->delay_timer != 0) interpreter->delay_timer--;
     if(interpreter->sound_timer != 0) interpreter->sound_timer--;
-    draw_display(screen->renderer, interpreter->display);
-    play_sound(screen->stream, interpreter->sound_timer);
 }
 
-// returns the value that VF register should be set to.
-static uint8_t draw_sprite(struct interpreter* interpreter, uint8_t x, uint8_t y, uint8_t h) {
-    uint8_t min_height = h < HEIGHT - y ? h : HEIGHT - y;
-    uint8_t* sprite_start = interpreter->memory + interpreter->index_register;
-    int set_vf_value = 0;
-    for(int j = 0; j < min_height; j++) {
-        for(int i = 0; i < 8; i++) {
-            if(x + i > WIDTH) break;
-            // we need bits from most to least significant, therefore 7 - i.
-            // the GET_BITS macro gets them from least to most significant
-            if(GET_BIT(sprite_start[j], 7 - i) == 0) continue;
-            if(interpreter->display[j + y][x + i]) set_vf_value = 1;
-            interpreter->display[j + y][x + i] = !interpreter->display[j + y][x + i];
+void update_internals(struct interpreter* interpreter) {
+    const struct platform* platform = interpreter->platform;
+    tick_timers(interpreter);
+    if(interpreter->dirty_rows != 0) {
+        uint64_t start = interpreter->profile != NULL ? monotonic_ns() : 0;
+        platform->draw_display(platform->userdata, &interpreter->display);
+        if(interpreter->profile != NULL) {
+            end_timing(interpreter->profile, &interpreter->profile->draw_display, start);
         }
+        interpreter->dirty_rows = 0;
     }
-    return set_vf_value;
+    platform->play_sound(platform->userdata, interpreter->sound_timer,
+            interpreter->has_pattern ? &interpreter->sound : NULL);
 }
 
-void decode(struct interpreter* interpreter, uint16_t instruction) {
-    switch(NIBBLE_1(instruction)) {
-        case 0x0:
-            // 0x00E0: clear screen.
-            if(AFTER_NIBBLE_1(instruction) == 0x0E0) {
-                clear_display(interpreter->display);
-            // 0x00EE: Return, i.e. PC <- STACK_POP
-            } else if(AFTER_NIBBLE_1(instruction) == 0x0EE) {
-                interpreter->program_counter = STACK_POP(&interpreter->stack);
-            }
-            break;
-        // 0x1NNN: jump, i.e. PC <- NNN
-        case 0x1:
-            interpreter->program_counter = AFTER_NIBBLE_1(instruction);
-            break;
-        // 0x2NNN: subroutine / call, i.e. STACK_PUSH(PC), PC <- NNN
-        case 0x2:
-            STACK_PUSH(&interpreter->stack, interpreter->program_counter);
-            interpreter->program_counter = AFTER_NIBBLE_1(instruction);
-            break;
-        // 0x3XNN: skip if equal, i.e. if(VX == NN) PC+=2
-        case 0x3:
-            if(interpreter->registers[NIBBLE_2(instruction)] == BYTE_2(instruction)) {
-                interpreter->program_counter += 2; // skip next instruction.
-            }
-            break;
-        // 0x3XNN: skip if not equal, i.e. if(VX != NN) PC+=2
-        case 0x4:
-            if(interpreter->registers[NIBBLE_2(instruction)] != BYTE_2(instruction)) {
-                interpreter->program_counter += 2; // skip next instruction.
-            }
-            break;
-        // 0x5XY0: skip if equal (registers), i.e. if(VX == VY) PC+=2
-        case 0x5:
-            if(interpreter->registers[NIBBLE_2(instruction)] ==
-                    interpreter->registers[NIBBLE_3(instruction)]) {
-                interpreter->program_counter += 2; // skip next instruction.
-            }
-            break;
-        // 0x6XNN: assignment with immediate, i.e. V6 <- NN
-        case 0x6:
-            interpreter->registers[NIBBLE_2(instruction)] = BYTE_2(instruction);
-            break;
-        // 0x7XNN: addition with immediate, i.e. VX <- VX + NN
-        case 0x7:
-            interpreter->registers[NIBBLE_2(instruction)] += BYTE_2(instruction);
-            break;
-        // various arithmetic between registers.
-        case 0x8: {
-            switch(NIBBLE_4(instruction)) {
-                // 0x8XY0: assignment between registers, i.e. VX <- VY
-                case 0x0:
-                    interpreter->registers[NIBBLE_2(instruction)] =
-                        interpreter->registers[NIBBLE_3(instruction)];
-                    break;
-                // 0x8XY1: bitwise or, i.e. VX <- VX | VY
-                case 0x1:
-                    interpreter->registers[NIBBLE_2(instruction)] |=
-                        interpreter->registers[NIBBLE_3(instruction)];
-                    break;
-                // 0x8XY2: bitwise and, i.e. VX <- VX & VY
-                case 0x2:
-                    interpreter->registers[NIBBLE_2(instruction)] &=
-                        interpreter->registers[NIBBLE_3(instruction)];
-                    break;
-                // 0x8XY3: bitwise xor, i.e. VX <- VX ^ VY
-                case 0x3:
-                    interpreter->registers[NIBBLE_2(instruction)] ^=
-                        interpreter->registers[NIBBLE_3(instruction)];
-                    break;
-                // 0x8XY4: addition, i.e. VX <- VX + VY, VF = carry
-                case 0x4: {
-                    uint8_t first = interpreter->registers[NIBBLE_2(instruction)];
-                    uint8_t second = interpreter->registers[NIBBLE_3(instruction)];
-                    interpreter->registers[NIBBLE_2(instruction)] += second;
-                    interpreter->registers[0xF] = first > UINT8_MAX - second;
-                    break;
-                }
-                // 0x8XY5: subtraction, i.e. VX <- VX - VY, VF = no borrow
-                case 0x5: {
-                    uint8_t first = interpreter->registers[NIBBLE_2(instruction)];
-                    uint8_t second = interpreter->registers[NIBBLE_3(instruction)];
-                    interpreter->registers[NIBBLE_2(instruction)] = first - second;
-                    interpreter->registers[0xF] = first > second;
-                    break;
-                }
-                // 0x8XY6 shift right: An ambiguous instruction.
-                // the ambiguous bit: VX <- VY
-                // The same: VX -> VX >> 1
-                // VF is set to the shifted out bit.
-                case 0x6: {
-#ifdef SHIFT_OPTION
-                    interpreter->registers[NIBBLE_2(instruction)] =
-                        interpreter->registers[NIBBLE_3(instruction)];
-#endif
-                    uint8_t bit = GET_BIT(interpreter->registers[
-                            NIBBLE_2(instruction)], 0);
-                    interpreter->registers[NIBBLE_2(instruction)] >>= 1;
-                    interpreter->registers[0xF] = bit;
-                    break;
-                }
-                // 0x8XY7: subtraction reverse, i.e. VX <- VY - VX, VF = no borrow
-                case 0x7: {
-                    uint8_t first = interpreter->registers[NIBBLE_2(instruction)];
-                    uint8_t second = interpreter->registers[NIBBLE_3(instruction)];
-                    interpreter->registers[NIBBLE_2(instruction)] = second - first;
-                    interpreter->registers[0xF] = second > first;
-                    break;
-                }
-                // 0x8XY6 shift left: An ambiguous instruction.
-                // the ambiguous bit: VX <- VY
-                // The same: VX -> VX << 1
-                // VF is set to the shifted out bit.
-                case 0xE: {
-#ifdef SHIFT_OPTION
-                    interpreter->registers[NIBBLE_2(instruction)] =
-                        interpreter->registers[NIBBLE_3(instruction)];
-#endif
-                    uint8_t bit = GET_BIT(interpreter->registers[
-                            NIBBLE_2(instruction)], 0);
-                    interpreter->registers[NIBBLE_2(instruction)] <<= 1;
-                    interpreter->registers[0xF] = bit;
-                    break;
+// clears the rows in use of each plane in `planes`; the rest are clear already.
+void clear_display(struct display* display, uint8_t planes) {
+    // sizes the compiler knows, so each memset is a few wide stores.
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        if(!(planes & (1 << plane))) continue;
+        if(display->hires) {
+            memset(display->planes[plane], 0, sizeof(display->planes[plane]));
+        } else {
+            memset(display->planes[plane], 0, HEIGHT * sizeof(display->planes[plane][0]));
+        }
+    }
+}
+
+static bool is_key_pressed(struct interpreter* interpreter, uint8_t num) {
+    return (interpreter->keys >> num) & 0x01;
+}
+
+// every row has to be drawn (and snapshotted) again.
+static void mark_display(struct interpreter* interpreter) {
+    interpreter->dirty_rows = ~0ull;
+    interpreter->changed_rows = ~0ull;
+    interpreter->effects++;
+}
+
+/**
+ * XORs one row of a sprite into `row` at column `x`, with `bits` lined up
+ * with column 0 of a word. Anything shifted past the right edge just falls
+ * off (clipping).
+ * @return  the pixels it turned off.
+ **/
+static uint64_t draw_row(uint64_t* row, uint64_t bits, uint8_t x, bool hires) {
+    uint64_t first = x < 64 ? bits >> x : 0;
+    uint64_t collision = row[0] & first;
+    row[0] ^= first;
+    if(hires) {
+        uint64_t second = x == 0 ? 0 : x < 64 ? bits << (64 - x) : bits >> (x - 64);
+        collision |= row[1] & second;
+        row[1] ^= second;
+    }
+    return collision;
+}
+
+/**
+ * Draws an `h` row sprite from M[I] at (x, y), or a 16x16 one for h = 0, into
+ * each plane selected, the sprite for each plane following the last in memory.
+ * The position wraps around the display, but the sprite is clipped.
+ * returns the value that VF register should be set to.
+ **/
+static uint8_t draw_sprite(struct interpreter* interpreter, uint8_t x, uint8_t y, uint8_t h) {
+    struct display* display = &interpreter->display;
+    uint16_t sprite_start = interpreter->index_register;
+    uint64_t collision = 0;
+    uint8_t min_height;
+    if(interpreter->planes == 0x01 && !display->hires && h != 0) {
+        // plain CHIP-8, which is nearly every sprite: one word per row of one plane.
+        x &= WIDTH - 1;
+        y &= HEIGHT - 1;
+        min_height = h < HEIGHT - y ? h : HEIGHT - y;
+        uint64_t (*rows)[ROW_WORDS] = display->planes[0] + y;
+        for(int j = 0; j < min_height; j++) {
+            // line the sprite byte up with column 0, then move it to column x.
+            uint64_t sprite = READ_MEMORY(interpreter, sprite_start + j);
+            uint64_t line = (sprite << (WIDTH - 8)) >> x;
+            collision |= rows[j][0] & line;
+            rows[j][0] ^= line;
+        }
+    } else {
+        x &= DISPLAY_WIDTH(display) - 1;
+        y &= DISPLAY_HEIGHT(display) - 1;
+        uint8_t rows = h != 0 ? h : 16;
+        min_height = rows < DISPLAY_HEIGHT(display) - y ? rows : DISPLAY_HEIGHT(display) - y;
+        for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+            if(!(interpreter->planes & (1 << plane))) continue;
+            for(int j = 0; j < min_height; j++) {
+                uint64_t bits;
+                if(h != 0) {
+                    bits = (uint64_t) READ_MEMORY(interpreter, sprite_start + j) << 56;
+                } else {
+                    bits = ((uint64_t) READ_MEMORY(interpreter, sprite_start + 2 * j) << 56) |
+                        ((uint64_t) READ_MEMORY(interpreter, sprite_start + 2 * j + 1) << 48);
                 }
-                default:
-                    fprintf(stderr, "Unknown instruction %4X.\n", instruction);
-                    break;
+                collision |= draw_row(display->planes[plane][y + j], bits, x, display->hires);
             }
-            break;
+            sprite_start += h != 0 ? h : 32;
+        }
+    }
+    uint64_t drawn = ((1ull << min_height) - 1) << y;
+    interpreter->dirty_rows |= drawn;
+    interpreter->changed_rows |= drawn;
+    interpreter->effects++;
+    return collision != 0;
+}
+
+/**
+ * Moves the rows of the selected planes `n` rows down, or up, a row (i.e.
+ * ROW_WORDS words) at a time. Rows moved in from outside are blank.
+ **/
+static void scroll_rows(struct interpreter* interpreter, uint8_t n, bool down) {
+    struct display* display = &interpreter->display;
+    uint8_t height = DISPLAY_HEIGHT(display);
+    if(n > height) n = height;
+    size_t row = sizeof(display->planes[0][0]);
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        if(!(interpreter->planes & (1 << plane))) continue;
+        uint64_t (*rows)[ROW_WORDS] = display->planes[plane];
+        if(down) {
+            memmove(rows[n], rows[0], (height - n) * row);
+            memset(rows[0], 0, n * row);
+        } else {
+            memmove(rows[0], rows[n], (height - n) * row);
+            memset(rows[height - n], 0, n * row);
         }
-        // 0x9XY0: skip if not equal (registers), i.e. if(VX != VY) PC+=2
-        case 0x9:
-            if(interpreter->registers[NIBBLE_2(instruction)] != 
-                    interpreter->registers[NIBBLE_3(instruction)]) {
-                interpreter->program_counter += 2; // skip next instruction.
+    }
+    mark_display(interpreter);
+}
+
+// moves the selected planes 4 pixels right or left, shifting whole words.
+static void scroll_columns(struct interpreter* interpreter, bool right) {
+    struct display* display = &interpreter->display;
+    uint8_t height = DISPLAY_HEIGHT(display);
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        if(!(interpreter->planes & (1 << plane))) continue;
+        for(uint8_t i = 0; i < height; i++) {
+            uint64_t* words = display->planes[plane][i];
+            if(!display->hires) {
+                words[0] = right ? words[0] >> 4 : words[0] << 4;
+            } else if(right) {
+                words[1] = (words[1] >> 4) | (words[0] << 60);
+                words[0] >>= 4;
+            } else {
+                words[0] = (words[0] << 4) | (words[1] >> 60);
+                words[1] <<= 4;
             }
-            break;
-        // 0xANNN: assignment of index register, i.e. I <- NNN
-        case 0xA:
-            interpreter->index_register = AFTER_NIBBLE_1(instruction);
-            break;
-        // 0xBXNN jump with offset: ambiguous instruction.
-        // Either PC <- V0 + XNN, or
-        // PC <- VX + XNN. This is silly. e.g. B220 will set PC <- V2 + 220.
-        case 0xB:
-#ifdef JUMP_OFFSET_OPTION
-            interpreter->program_counter = interpreter->registers[NIBBLE_2(instruction)] + AFTER_NIBBLE_1(instruction);
-#else
-            interpreter->program_counter = interpreter->registers[0x0] + AFTER_NIBBLE_1(instruction);
-#endif
-            break;
-        // 0xCXNN: random, i.e. VX <- rand[0, 255] & NN
-        case 0xC:
-            interpreter->registers[NIBBLE_2(instruction)] = 
-                rand() & BYTE_2(instruction); 
-            break;
-        // 0xDXYN: display an N-byte sprite starting at M[I] at position (VX, VY).
-        // This display is an XOR with the existing bit of the screen.
-        // VF = collision, i.e. whether a pixel is erased / st off..
-        // Only wraps around if the WHOLE sprite is off-screen.
-        case 0xD: {
-            uint8_t x = interpreter->registers[NIBBLE_2(instruction)] & (WIDTH - 1);
-            uint8_t y = interpreter->registers[NIBBLE_3(instruction)] & (HEIGHT - 1);
-            uint8_t height = NIBBLE_4(instruction);
-
-            interpreter->registers[0xF] = draw_sprite(interpreter, x, y, height);
-            break;
         }
-        // key: skip next instruction if key in V[N2] is being pressed, i.e. poll for input.
-        case 0xE:
-            // 0xEX9E: skip if key pressed, i.e. if(key_pressed(VX)) PC+=2
-            if(BYTE_2(instruction) == 0x9E &&
-                    is_key_pressed(NIBBLE_2_BYTE(
-                    interpreter->registers[NIBBLE_2(instruction)]))) {
-                interpreter->program_counter += 2;
-            // 0xEX9E: skip if not key pressed, i.e. if(!key_pressed(VX)) PC+=2
-            } else if(BYTE_2(instruction) == 0xA1 &&
-                    !is_key_pressed(NIBBLE_2_BYTE(
-                    interpreter->registers[NIBBLE_2(instruction)]))) {
-                interpreter->program_counter += 2;
-            } else if(BYTE_2(instruction) != 0x9E && BYTE_2(instruction) != 0xA1) {
-                fprintf(stderr, "Unknown instruction %4X.\n", instruction);
+    }
+    mark_display(interpreter);
+}
+
+/**
+ * Stores a byte in memory. Every write goes through here so that a decoded
+ * instruction in the cache never outlives the bytes it was decoded from.
+ **/
+void write_memory(struct interpreter* interpreter, uint16_t address, uint8_t value) {
+    address &= MEMORY_SIZE - 1;
+    interpreter->memory[address] = value;
+    interpreter->dirty_pages |= 1 << (address / MEMORY_PAGE_SIZE);
+    interpreter->effects++;
+    interpreter->cache[address >> 1].handler = OP_UNDECODED;
+    if(interpreter->jit != NULL) {
+        jit_invalidate(interpreter->jit, address);
+    }
+}
+
+// skips the next instruction, all four bytes of it for F000 NNNN.
+static void skip(struct interpreter* interpreter) {
+    interpreter->program_counter += instruction_length(interpreter, interpreter->program_counter);
+}
+
+/**
+ * The operations themselves. Each one gets its operands already pulled
+ * out of the instruction by interpreter->decode_operation(), and runs with the program
+ * counter already pointing at the next instruction.
+ **/
+// 0x0NNN: call machine code routine. Not supported, so ignored.
+static void op_system(struct interpreter* interpreter, const struct operation* op) {
+    (void) interpreter, (void) op;
+}
+
+// 0x00E0: clear screen.
+// Only the planes selected, see FN01.
+static void op_clear(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    clear_display(&interpreter->display, interpreter->planes);
+    mark_display(interpreter);
+}
+
+/**
+ * Stops the program on the instruction that is running, reporting why the
+ * first time. It then just keeps faulting there, which costs no more than
+ * a check in the handful of operations that can fault.
+ **/
+static void raise_fault(struct interpreter* interpreter, enum fault fault) {
+    interpreter->program_counter -= 2;
+    if(interpreter->fault == FAULT_NONE && fault == FAULT_EXIT) {
+        fprintf(stderr, "Exited at %03X.\n", interpreter->program_counter);
+    } else if(interpreter->fault == FAULT_NONE) {
+        fprintf(stderr, "Stack %s at %03X.\n",
+                fault == FAULT_STACK_OVERFLOW ? "overflow" : "underflow",
+                interpreter->program_counter);
+    }
+    interpreter->fault = fault;
+}
+
+// 0x00EE: Return, i.e. PC <- STACK_POP
+static void op_return(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    if(interpreter->stack_pointer == 0) {
+        raise_fault(interpreter, FAULT_STACK_UNDERFLOW);
+        return;
+    }
+    interpreter->program_counter = interpreter->stack[--interpreter->stack_pointer];
+}
+
+// 0x1NNN: jump, i.e. PC <- NNN
+static void op_jump(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->program_counter = OP_NNN(op);
+}
+
+// 0x2NNN: subroutine / call, i.e. STACK_PUSH(PC), PC <- NNN
+static void op_call(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->stack_pointer >= interpreter->stack_depth) {
+        raise_fault(interpreter, FAULT_STACK_OVERFLOW);
+        return;
+    }
+    interpreter->stack[interpreter->stack_pointer++] = interpreter->program_counter;
+    interpreter->program_counter = OP_NNN(op);
+}
+
+// 0x3XNN: skip if equal, i.e. if(VX == NN) PC+=2
+static void op_skip_equal_immediate(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->registers[OP_X(op)] == OP_NN(op)) {
+        skip(interpreter);
+    }
+}
+
+// 0x4XNN: skip if not equal, i.e. if(VX != NN) PC+=2
+static void op_skip_not_equal_immediate(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->registers[OP_X(op)] != OP_NN(op)) {
+        skip(interpreter);
+    }
+}
+
+// 0x5XY0: skip if equal (registers), i.e. if(VX == VY) PC+=2
+static void op_skip_equal_register(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->registers[OP_X(op)] == interpreter->registers[OP_Y(op)]) {
+        skip(interpreter);
+    }
+}
+
+// 0x6XNN: assignment with immediate, i.e. V6 <- NN
+static void op_set_immediate(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = OP_NN(op);
+}
+
+// 0x7XNN: addition with immediate, i.e. VX <- VX + NN
+static void op_add_immediate(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] += OP_NN(op);
+}
+
+// 0x8XY0: assignment between registers, i.e. VX <- VY
+static void op_set_register(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = interpreter->registers[OP_Y(op)];
+}
+
+// 0x8XY1: bitwise or, i.e. VX <- VX | VY
+static void op_or(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] |= interpreter->registers[OP_Y(op)];
+}
+
+// 0x8XY2: bitwise and, i.e. VX <- VX & VY
+static void op_and(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] &= interpreter->registers[OP_Y(op)];
+}
+
+// 0x8XY3: bitwise xor, i.e. VX <- VX ^ VY
+static void op_xor(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] ^= interpreter->registers[OP_Y(op)];
+}
+
+// 0x8XY4: addition, i.e. VX <- VX + VY, VF = carry
+static void op_add_register(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t first = interpreter->registers[OP_X(op)];
+    uint8_t second = interpreter->registers[OP_Y(op)];
+    interpreter->registers[OP_X(op)] += second;
+    interpreter->registers[0xF] = first > UINT8_MAX - second;
+}
+
+// 0x8XY5: subtraction, i.e. VX <- VX - VY, VF = no borrow
+static void op_subtract(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t first = interpreter->registers[OP_X(op)];
+    uint8_t second = interpreter->registers[OP_Y(op)];
+    interpreter->registers[OP_X(op)] = first - second;
+    interpreter->registers[0xF] = first > second;
+}
+
+// 0x8XY6 shift right: An ambiguous instruction.
+// the ambiguous bit: VX <- VY (QUIRK_SHIFT_VY)
+// The same: VX -> VX >> 1
+// VF is set to the shifted out bit.
+static void op_shift_right(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t bit = GET_BIT(interpreter->registers[OP_X(op)], 0);
+    interpreter->registers[OP_X(op)] >>= 1;
+    interpreter->registers[0xF] = bit;
+}
+
+// 0x8XY7: subtraction reverse, i.e. VX <- VY - VX, VF = no borrow
+static void op_subtract_reverse(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t first = interpreter->registers[OP_X(op)];
+    uint8_t second = interpreter->registers[OP_Y(op)];
+    interpreter->registers[OP_X(op)] = second - first;
+    interpreter->registers[0xF] = second > first;
+}
+
+// 0x8XYE shift left: An ambiguous instruction.
+// the ambiguous bit: VX <- VY (QUIRK_SHIFT_VY)
+// The same: VX -> VX << 1
+// VF is set to the shifted out bit.
+static void op_shift_left(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t bit = GET_BIT(interpreter->registers[OP_X(op)], 7);
+    interpreter->registers[OP_X(op)] <<= 1;
+    interpreter->registers[0xF] = bit;
+}
+
+// 0x9XY0: skip if not equal (registers), i.e. if(VX != VY) PC+=2
+static void op_skip_not_equal_register(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->registers[OP_X(op)] != interpreter->registers[OP_Y(op)]) {
+        skip(interpreter);
+    }
+}
+
+// 0xANNN: assignment of index register, i.e. I <- NNN
+static void op_set_index(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->index_register = OP_NNN(op);
+}
+
+// 0xBXNN jump with offset: ambiguous instruction.
+// Either PC <- V0 + XNN, or
+// PC <- VX + XNN (QUIRK_JUMP_VX). This is silly. e.g. B220 will set PC <- V2 + 220.
+static void op_jump_offset(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->program_counter = interpreter->registers[0x0] + OP_NNN(op);
+}
+
+// 0xCXNN: random, i.e. VX <- rand[0, 255] & NN
+static void op_random(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = random_byte(interpreter) & OP_NN(op);
+}
+
+// 0xDXYN: display an N-byte sprite starting at M[I] at position (VX, VY).
+// This display is an XOR with the existing bit of the screen.
+// VF = collision, i.e. whether a pixel is erased / st off..
+// Only wraps around if the WHOLE sprite is off-screen.
+// DXY0 draws a 16x16 sprite of two bytes a row (SUPER-CHIP).
+static void op_draw(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t x = interpreter->registers[OP_X(op)];
+    uint8_t y = interpreter->registers[OP_Y(op)];
+    interpreter->registers[0xF] = draw_sprite(interpreter, x, y, OP_N(op));
+    if(interpreter->latency != NULL) note_draw(interpreter->latency);
+}
+
+// 0xEX9E: skip if key pressed, i.e. if(key_pressed(VX)) PC+=2
+static void op_skip_key(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->latency != NULL) note_key_read(interpreter->latency);
+    if(is_key_pressed(interpreter, NIBBLE_2_BYTE(interpreter->registers[OP_X(op)]))) {
+        skip(interpreter);
+    }
+}
+
+// 0xEXA1: skip if not key pressed, i.e. if(!key_pressed(VX)) PC+=2
+static void op_skip_not_key(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->latency != NULL) note_key_read(interpreter->latency);
+    if(!is_key_pressed(interpreter, NIBBLE_2_BYTE(interpreter->registers[OP_X(op)]))) {
+        skip(interpreter);
+    }
+}
+
+// 0xFX07: VX <- delay timer
+static void op_get_delay(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = interpreter->delay_timer;
+}
+
+// 0xFX0A: blocking instruction that waits for a key to be pressed and released,
+// whose value is put into VX. If several are let go at once, the least one.
+// note that this does not stop execution entirely. timers still decrease.
+static void op_wait_key(struct interpreter* interpreter, const struct operation* op) {
+    if(interpreter->latency != NULL) note_key_read(interpreter->latency);
+    uint16_t released = interpreter->waiting_keys & ~interpreter->keys;
+    if(released == 0) {
+        interpreter->waiting_keys |= interpreter->keys;
+        interpreter->program_counter -= 2;
+    } else {
+        interpreter->registers[OP_X(op)] = __builtin_ctz(released);
+        interpreter->waiting_keys = 0;
+    }
+}
+
+// 0xFX15: delay timer <- VX
+static void op_set_delay(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->delay_timer = interpreter->registers[OP_X(op)];
+}
+
+// 0xFX18: sound timer <- VX
+static void op_set_sound(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->sound_timer = interpreter->registers[OP_X(op)];
+}
+
+// 0xFX1E: I <- I + VX, where it is ambiguous if VF is set on overflow (QUIRK_INDEX_FLAG).
+static void op_add_index(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->index_register += interpreter->registers[OP_X(op)];
+}
+
+// 0xFX29: font character: I <- address of character VX in memory
+// this looks at the lower nibble of VX for the character.
+// All character fonts take up 5 bytes of memory.
+static void op_font(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t character = NIBBLE_2_BYTE(interpreter->registers[OP_X(op)]);
+    interpreter->index_register = FONT_START_ADDRESS + character * 5;
+}
+
+// 0xFX33: Binary-coded decimal conversion.
+// Takes number in VX (one byte) and converts it to three decimal digits,
+// stores these at M[I], M[I+1], and M[I+2] for 100s, 10s, 1s respectively.
+// e.g. if VX stores 123, M[I] <- 1, M[I+1] <- 2, M[I+2] <- 3
+static void op_decimal(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t digits = interpreter->registers[OP_X(op)];
+    uint16_t index = interpreter->index_register;
+    write_memory(interpreter, index + 2, digits % 10);
+    digits /= 10;
+    write_memory(interpreter, index + 1, digits % 10);
+    digits /= 10;
+    write_memory(interpreter, index, digits);
+}
+
+// 0xFX55: store registers subsequently to memory, where M[I + i] <- Vi.
+// For this and FX65, it is ambiguous whether I is incremented or not.
+// Modern implementations do NOT increment I (see QUIRK_INDEX_INCREMENT*).
+static void op_store(struct interpreter* interpreter, const struct operation* op) {
+    for(uint8_t i = 0; i <= OP_X(op); i++) {
+        write_memory(interpreter, interpreter->index_register + i,
+                interpreter->registers[i]);
+    }
+}
+
+// 0xFX65: load registers, where Vi <- M[I + i].
+static void op_load(struct interpreter* interpreter, const struct operation* op) {
+    for(uint8_t i = 0; i <= OP_X(op); i++) {
+        interpreter->registers[i] =
+            READ_MEMORY(interpreter, interpreter->index_register + i);
+    }
+}
+
+/* The same instructions under a quirk. The decoder picks between these. */
+
+static void op_shift_right_vy(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = interpreter->registers[OP_Y(op)];
+    op_shift_right(interpreter, op);
+}
+
+static void op_shift_left_vy(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->registers[OP_X(op)] = interpreter->registers[OP_Y(op)];
+    op_shift_left(interpreter, op);
+}
+
+static void op_jump_offset_vx(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->program_counter = interpreter->registers[OP_X(op)] + OP_NNN(op);
+}
+
+static void op_add_index_flag(struct interpreter* interpreter, const struct operation* op) {
+    op_add_index(interpreter, op);
+    interpreter->registers[0xF] = interpreter->index_register > 0xFFF;
+}
+
+static void op_store_increment(struct interpreter* interpreter, const struct operation* op) {
+    op_store(interpreter, op);
+    interpreter->index_register += OP_X(op) + 1;
+}
+
+static void op_load_increment(struct interpreter* interpreter, const struct operation* op) {
+    op_load(interpreter, op);
+    interpreter->index_register += OP_X(op) + 1;
+}
+
+static void op_store_increment_x(struct interpreter* interpreter, const struct operation* op) {
+    op_store(interpreter, op);
+    interpreter->index_register += OP_X(op);
+}
+
+static void op_load_increment_x(struct interpreter* interpreter, const struct operation* op) {
+    op_load(interpreter, op);
+    interpreter->index_register += OP_X(op);
+}
+
+// 0xF002: audio, i.e. sound pattern <- the 16 bytes from I.
+static void op_audio(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    for(uint8_t i = 0; i < sizeof(interpreter->sound.bits); i++) {
+        interpreter->sound.bits[i] = READ_MEMORY(interpreter, interpreter->index_register + i);
+    }
+    interpreter->has_pattern = true;
+    interpreter->effects++;
+}
+
+// 0xFX3A: pitch, i.e. sound pitch <- VX
+static void op_pitch(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->sound.pitch = interpreter->registers[OP_X(op)];
+    interpreter->effects++;
+}
+
+// 0x00CN: scroll down N rows.
+static void op_scroll_down(struct interpreter* interpreter, const struct operation* op) {
+    scroll_rows(interpreter, OP_N(op), true);
+}
+
+// 0x00FB: scroll right 4 pixels.
+static void op_scroll_right(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    scroll_columns(interpreter, true);
+}
+
+// 0x00FC: scroll left 4 pixels.
+static void op_scroll_left(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    scroll_columns(interpreter, false);
+}
+
+// 0x00FD: exit, i.e. the program stops here for good.
+static void op_exit(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    raise_fault(interpreter, FAULT_EXIT);
+}
+
+// 0x00FE and 0x00FF: low and high resolution. Either clears the display.
+static void set_resolution(struct interpreter* interpreter, bool hires) {
+    interpreter->display.hires = hires;
+    memset(interpreter->display.planes, 0, sizeof(interpreter->display.planes));
+    mark_display(interpreter);
+}
+
+static void op_low_resolution(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    set_resolution(interpreter, false);
+}
+
+static void op_high_resolution(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    set_resolution(interpreter, true);
+}
+
+// 0xFX30: big font character: I <- address of the 8x10 character VX.
+static void op_big_font(struct interpreter* interpreter, const struct operation* op) {
+    uint8_t character = NIBBLE_2_BYTE(interpreter->registers[OP_X(op)]);
+    interpreter->index_register = BIG_FONT_START_ADDRESS + character * 10;
+}
+
+// 0xFX75: save V0 to VX in the user flags.
+static void op_save_flags(struct interpreter* interpreter, const struct operation* op) {
+    memcpy(interpreter->flags, interpreter->registers, OP_X(op) + 1);
+    interpreter->effects++;
+}
+
+// 0xFX85: load V0 to VX from the user flags.
+static void op_load_flags(struct interpreter* interpreter, const struct operation* op) {
+    memcpy(interpreter->registers, interpreter->flags, OP_X(op) + 1);
+}
+
+// 0x00DN: scroll up N rows.
+static void op_scroll_up(struct interpreter* interpreter, const struct operation* op) {
+    scroll_rows(interpreter, OP_N(op), false);
+}
+
+// 0x5XY2: save VX to VY at M[I], going backwards if X > Y. I is left alone.
+static void op_save_range(struct interpreter* interpreter, const struct operation* op) {
+    int step = OP_X(op) <= OP_Y(op) ? 1 : -1;
+    uint8_t count = (OP_X(op) <= OP_Y(op) ? OP_Y(op) - OP_X(op) : OP_X(op) - OP_Y(op)) + 1;
+    for(uint8_t i = 0; i < count; i++) {
+        write_memory(interpreter, interpreter->index_register + i,
+                interpreter->registers[OP_X(op) + step * i]);
+    }
+}
+
+// 0x5XY3: load VX to VY from M[I], the same way.
+static void op_load_range(struct interpreter* interpreter, const struct operation* op) {
+    int step = OP_X(op) <= OP_Y(op) ? 1 : -1;
+    uint8_t count = (OP_X(op) <= OP_Y(op) ? OP_Y(op) - OP_X(op) : OP_X(op) - OP_Y(op)) + 1;
+    for(uint8_t i = 0; i < count; i++) {
+        interpreter->registers[OP_X(op) + step * i] =
+            READ_MEMORY(interpreter, interpreter->index_register + i);
+    }
+}
+
+// 0xF000 NNNN: I <- NNNN, from the two bytes after the instruction.
+static void op_long_index(struct interpreter* interpreter, const struct operation* op) {
+    (void) op;
+    interpreter->index_register = fetch(interpreter);
+}
+
+// 0xFN01: draw to, clear and scroll the planes in bitmask N.
+static void op_planes(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->planes = OP_X(op) & ((1 << DISPLAY_PLANES) - 1);
+    interpreter->effects++;
+}
+
+// Anything else.
+static void op_unknown(struct interpreter* interpreter, const struct operation* op) {
+    interpreter->effects++; // the message, which each run should still print.
+    fprintf(stderr, "Unknown instruction %4X.\n", op->instruction);
+}
+
+static const operation_handler handlers[OP_COUNT] = {
+    [OP_SYSTEM] = op_system,
+    [OP_CLEAR] = op_clear,
+    [OP_RETURN] = op_return,
+    [OP_JUMP] = op_jump,
+    [OP_CALL] = op_call,
+    [OP_SKIP_EQUAL_IMMEDIATE] = op_skip_equal_immediate,
+    [OP_SKIP_NOT_EQUAL_IMMEDIATE] = op_skip_not_equal_immediate,
+    [OP_SKIP_EQUAL_REGISTER] = op_skip_equal_register,
+    [OP_SET_IMMEDIATE] = op_set_immediate,
+    [OP_ADD_IMMEDIATE] = op_add_immediate,
+    [OP_SET_REGISTER] = op_set_register,
+    [OP_OR] = op_or,
+    [OP_AND] = op_and,
+    [OP_XOR] = op_xor,
+    [OP_ADD_REGISTER] = op_add_register,
+    [OP_SUBTRACT] = op_subtract,
+    [OP_SHIFT_RIGHT] = op_shift_right,
+    [OP_SUBTRACT_REVERSE] = op_subtract_reverse,
+    [OP_SHIFT_LEFT] = op_shift_left,
+    [OP_SKIP_NOT_EQUAL_REGISTER] = op_skip_not_equal_register,
+    [OP_SET_INDEX] = op_set_index,
+    [OP_JUMP_OFFSET] = op_jump_offset,
+    [OP_RANDOM] = op_random,
+    [OP_DRAW] = op_draw,
+    [OP_SKIP_KEY] = op_skip_key,
+    [OP_SKIP_NOT_KEY] = op_skip_not_key,
+    [OP_GET_DELAY] = op_get_delay,
+    [OP_WAIT_KEY] = op_wait_key,
+    [OP_SET_DELAY] = op_set_delay,
+    [OP_SET_SOUND] = op_set_sound,
+    [OP_ADD_INDEX] = op_add_index,
+    [OP_FONT] = op_font,
+    [OP_DECIMAL] = op_decimal,
+    [OP_STORE] = op_store,
+    [OP_LOAD] = op_load,
+    [OP_SHIFT_RIGHT_VY] = op_shift_right_vy,
+    [OP_SHIFT_LEFT_VY] = op_shift_left_vy,
+    [OP_JUMP_OFFSET_VX] = op_jump_offset_vx,
+    [OP_ADD_INDEX_FLAG] = op_add_index_flag,
+    [OP_STORE_INCREMENT] = op_store_increment,
+    [OP_LOAD_INCREMENT] = op_load_increment,
+    [OP_STORE_INCREMENT_X] = op_store_increment_x,
+    [OP_LOAD_INCREMENT_X] = op_load_increment_x,
+    [OP_AUDIO] = op_audio,
+    [OP_PITCH] = op_pitch,
+    [OP_SCROLL_DOWN] = op_scroll_down,
+    [OP_SCROLL_RIGHT] = op_scroll_right,
+    [OP_SCROLL_LEFT] = op_scroll_left,
+    [OP_EXIT] = op_exit,
+    [OP_LOW_RESOLUTION] = op_low_resolution,
+    [OP_HIGH_RESOLUTION] = op_high_resolution,
+    [OP_BIG_FONT] = op_big_font,
+    [OP_SAVE_FLAGS] = op_save_flags,
+    [OP_LOAD_FLAGS] = op_load_flags,
+    [OP_SCROLL_UP] = op_scroll_up,
+    [OP_SAVE_RANGE] = op_save_range,
+    [OP_LOAD_RANGE] = op_load_range,
+    [OP_LONG_INDEX] = op_long_index,
+    [OP_PLANES] = op_planes,
+    [OP_UNKNOWN] = op_unknown
+};
+
+/**
+ * Pulls an instruction apart into `op`, choosing its operation type for
+ * one fixed set of quirks. DEFINE_DECODER() stamps out a decoder per set;
+ * `quirks` is a literal there, so every QUIRK() folds away at compile time.
+ **/
+#define QUIRK(quirks, quirk, when_set, otherwise) \
+    (((quirks) & QUIRK_##quirk) ? (when_set) : (otherwise))
+
+#define DEFINE_DECODER(quirks) \
+static void decode_##quirks(uint16_t instruction, struct operation* op) { \
+    op->instruction = instruction; \
+\
+    switch(NIBBLE_1(instruction)) { \
+        case 0x0: \
+            if(OP_X(op) == 0x0 && OP_Y(op) == 0xC) { \
+                op->handler = OP_SCROLL_DOWN; \
+                return; \
+            } else if(OP_X(op) == 0x0 && OP_Y(op) == 0xD) { \
+                op->handler = OP_SCROLL_UP; \
+                return; \
+            } \
+            switch(AFTER_NIBBLE_1(instruction)) { \
+                case 0x0E0: op->handler = OP_CLEAR; return; \
+                case 0x0EE: op->handler = OP_RETURN; return; \
+                case 0x0FB: op->handler = OP_SCROLL_RIGHT; return; \
+                case 0x0FC: op->handler = OP_SCROLL_LEFT; return; \
+                case 0x0FD: op->handler = OP_EXIT; return; \
+                case 0x0FE: op->handler = OP_LOW_RESOLUTION; return; \
+                case 0x0FF: op->handler = OP_HIGH_RESOLUTION; return; \
+                default: op->handler = OP_SYSTEM; return; \
+            } \
+        case 0x1: op->handler = OP_JUMP; return; \
+        case 0x2: op->handler = OP_CALL; return; \
+        case 0x3: op->handler = OP_SKIP_EQUAL_IMMEDIATE; return; \
+        case 0x4: op->handler = OP_SKIP_NOT_EQUAL_IMMEDIATE; return; \
+        case 0x5: \
+            switch(NIBBLE_4(instruction)) { \
+                case 0x2: op->handler = OP_SAVE_RANGE; return; \
+                case 0x3: op->handler = OP_LOAD_RANGE; return; \
+                default: op->handler = OP_SKIP_EQUAL_REGISTER; return; \
+            } \
+        case 0x6: op->handler = OP_SET_IMMEDIATE; return; \
+        case 0x7: op->handler = OP_ADD_IMMEDIATE; return; \
+        /* various arithmetic between registers. */ \
+        case 0x8: \
+            switch(NIBBLE_4(instruction)) { \
+                case 0x0: op->handler = OP_SET_REGISTER; return; \
+                case 0x1: op->handler = OP_OR; return; \
+                case 0x2: op->handler = OP_AND; return; \
+                case 0x3: op->handler = OP_XOR; return; \
+                case 0x4: op->handler = OP_ADD_REGISTER; return; \
+                case 0x5: op->handler = OP_SUBTRACT; return; \
+                case 0x6: op->handler = QUIRK(quirks, SHIFT_VY, OP_SHIFT_RIGHT_VY, OP_SHIFT_RIGHT); return; \
+                case 0x7: op->handler = OP_SUBTRACT_REVERSE; return; \
+                case 0xE: op->handler = QUIRK(quirks, SHIFT_VY, OP_SHIFT_LEFT_VY, OP_SHIFT_LEFT); return; \
+            } \
+            break; \
+        case 0x9: op->handler = OP_SKIP_NOT_EQUAL_REGISTER; return; \
+        case 0xA: op->handler = OP_SET_INDEX; return; \
+        case 0xB: op->handler = QUIRK(quirks, JUMP_VX, OP_JUMP_OFFSET_VX, OP_JUMP_OFFSET); return; \
+        case 0xC: op->handler = OP_RANDOM; return; \
+        case 0xD: op->handler = OP_DRAW; return; \
+        /* key: skip next instruction if key in V[N2] is being pressed, i.e. poll for input. */ \
+        case 0xE: \
+            if(BYTE_2(instruction) == 0x9E) { \
+                op->handler = OP_SKIP_KEY; \
+                return; \
+            } else if(BYTE_2(instruction) == 0xA1) { \
+                op->handler = OP_SKIP_NOT_KEY; \
+                return; \
+            } \
+            break; \
+        /* wildcards. */ \
+        case 0xF: \
+            switch(BYTE_2(instruction)) { \
+                case 0x00: \
+                    if(OP_X(op) == 0) { \
+                        op->handler = OP_LONG_INDEX; \
+                        return; \
+                    } \
+                    break; \
+                case 0x01: op->handler = OP_PLANES; return; \
+                case 0x02: \
+                    if(OP_X(op) == 0) { \
+                        op->handler = OP_AUDIO; \
+                        return; \
+                    } \
+                    break; \
+                case 0x07: op->handler = OP_GET_DELAY; return; \
+                case 0x0A: op->handler = OP_WAIT_KEY; return; \
+                case 0x15: op->handler = OP_SET_DELAY; return; \
+                case 0x18: op->handler = OP_SET_SOUND; return; \
+                case 0x1E: op->handler = QUIRK(quirks, INDEX_FLAG, OP_ADD_INDEX_FLAG, OP_ADD_INDEX); return; \
+                case 0x29: op->handler = OP_FONT; return; \
+                case 0x30: op->handler = OP_BIG_FONT; return; \
+                case 0x33: op->handler = OP_DECIMAL; return; \
+                case 0x3A: op->handler = OP_PITCH; return; \
+                case 0x55: \
+                    op->handler = QUIRK(quirks, INDEX_INCREMENT, OP_STORE_INCREMENT, \
+                            QUIRK(quirks, INDEX_INCREMENT_X, OP_STORE_INCREMENT_X, OP_STORE)); \
+                    return; \
+                case 0x65: \
+                    op->handler = QUIRK(quirks, INDEX_INCREMENT, OP_LOAD_INCREMENT, \
+                            QUIRK(quirks, INDEX_INCREMENT_X, OP_LOAD_INCREMENT_X, OP_LOAD)); \
+                    return; \
+                case 0x75: op->handler = OP_SAVE_FLAGS; return; \
+                case 0x85: op->handler = OP_LOAD_FLAGS; return; \
+            } \
+            break; \
+    } \
+\
+    op->handler = OP_UNKNOWN; \
+}
+
+#define DEFINE_DECODERS(high) \
+    DEFINE_DECODER(high##0) DEFINE_DECODER(high##1) DEFINE_DECODER(high##2) DEFINE_DECODER(high##3) \
+    DEFINE_DECODER(high##4) DEFINE_DECODER(high##5) DEFINE_DECODER(high##6) DEFINE_DECODER(high##7) \
+    DEFINE_DECODER(high##8) DEFINE_DECODER(high##9) DEFINE_DECODER(high##A) DEFINE_DECODER(high##B) \
+    DEFINE_DECODER(high##C) DEFINE_DECODER(high##D) DEFINE_DECODER(high##E) DEFINE_DECODER(high##F)
+#define DECODERS(high) \
+    decode_##high##0, decode_##high##1, decode_##high##2, decode_##high##3, \
+    decode_##high##4, decode_##high##5, decode_##high##6, decode_##high##7, \
+    decode_##high##8, decode_##high##9, decode_##high##A, decode_##high##B, \
+    decode_##high##C, decode_##high##D, decode_##high##E, decode_##high##F
+
+DEFINE_DECODERS(0x0)
+DEFINE_DECODERS(0x1)
+
+// indexed by a set of quirks.
+static const operation_decoder decoders[QUIRK_COMBINATIONS] = {
+    DECODERS(0x0),
+    DECODERS(0x1)
+};
+
+#undef DECODERS
+#undef DEFINE_DECODERS
+#undef DEFINE_DECODER
+#undef QUIRK
+
+/**
+ * Picks the decoder for `quirks`. Call before running anything, as
+ * instructions already in the cache were decoded under the old ones.
+ **/
+void set_quirks(struct interpreter* interpreter, uint8_t quirks) {
+    interpreter->decode_operation = decoders[quirks & (QUIRK_COMBINATIONS - 1)];
+    memset(interpreter->cache, 0, sizeof(interpreter->cache));
+}
+
+// calls nested deeper than `depth` fault, see raise_fault().
+void set_stack_depth(struct interpreter* interpreter, uint8_t depth) {
+    interpreter->stack_depth = depth < STACK_MAX_DEPTH ? depth : STACK_MAX_DEPTH;
+}
+
+void decode(struct interpreter* interpreter, uint16_t instruction) {
+    struct operation op;
+    interpreter->decode_operation(instruction, &op);
+    handlers[op.handler](interpreter, &op);
+}
+
+operation_handler get_handler(uint8_t type) {
+    return handlers[type];
+}
+
+/**
+ * Runs one instruction, going through the decode cache when it can.
+ * Instructions at odd addresses don't line up with a cache slot, so those
+ * (rare) ones are decoded from scratch every time.
+ **/
+static void step(struct interpreter* interpreter) {
+    uint16_t address = interpreter->program_counter;
+    if((address & 0x01) || address >= MEMORY_SIZE - 1) {
+        decode(interpreter, fetch(interpreter));
+        return;
+    }
+
+    struct operation* op = &interpreter->cache[address >> 1];
+    if(op->handler == OP_UNDECODED) {
+        interpreter->decode_operation(fetch(interpreter), op);
+    }
+    interpreter->program_counter = address + 2;
+    handlers[op->handler](interpreter, op);
+}
+
+void interpret_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    while(cycles-- > 0) {
+        step(interpreter);
+    }
+}
+
+/**
+ * interpret_cycles(), counting what runs into interpreter->profile.
+ * Decoding and DXYN are timed as well, which costs far more than they do.
+ **/
+void profile_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    struct profile* profile = interpreter->profile;
+    uint64_t run = monotonic_ns();
+    while(cycles-- > 0) {
+        uint16_t address = interpreter->program_counter;
+        struct operation uncached;
+        struct operation* op = &uncached;
+        if((address & 0x01) || address >= MEMORY_SIZE - 1) {
+            uint64_t start = monotonic_ns();
+            interpreter->decode_operation(fetch(interpreter), op);
+            end_timing(profile, &profile->decode, start);
+        } else {
+            op = &interpreter->cache[address >> 1];
+            if(op->handler == OP_UNDECODED) {
+                uint64_t start = monotonic_ns();
+                interpreter->decode_operation(fetch(interpreter), op);
+                end_timing(profile, &profile->decode, start);
             }
-            break;
-        /**
-         * wildcards.
-         * FX07: set VX <- delay timer
-         * FX0A: blocking instruction that waits for any key, whose value is put into VX.
-         *       note that this does not stop execution entirely. timers still decrease.
-         * FX15: delay timer <- VX 
-         * FX18: sound timer <- VX 
-         * FX1E: I <- I + VX, where it is ambiguous if VF is set on overflow.
-         * FX29: font character: I <- address of character VX in memory
-         * FX33: Binary-coded decimal conversion.
-         *       Takes number in VX (one byte) and converts it to three decimal digits,
-         *       stores these at M[I], M[I+1], and M[I+2] for 100s, 10s, 1s respectively.
-         * FX55: store registers subsequently to memory, where M[I + i] <- Vi.
-         * FX65: load registers, where Vi <- M[I + i].
-         *       For these instructions, it is ambiguous whether I is incremented or not.
-         *       Modern implementations do NOT increment I.
-         **/
-        case 0xF: {
-            switch(BYTE_2(instruction)) {
-                case 0x07:
-                    interpreter->registers[NIBBLE_2(instruction)] = interpreter->delay_timer;
-                    break;
-                case 0x0A: {
-                    uint8_t response;
-                    if((response = any_key_pressed()) == 0xFF) {
-                        interpreter->program_counter -= 2;
-                    } else {
-                        interpreter->registers[NIBBLE_2(instruction)] = response;
-                    }
-                    break;
-                }
-                case 0x15:
-                    interpreter->delay_timer = interpreter->registers[NIBBLE_2(instruction)];
-                    break;
-                case 0x18:
-                    interpreter->sound_timer = interpreter->registers[NIBBLE_2(instruction)];
-                    break;
-                case 0x1E:
-                    interpreter->index_register += interpreter->registers[NIBBLE_2(instruction)];
-#ifdef INDEX_ADD_OBB_OPTION
-                    interpreter->registers[0xF] = interpreter->index_register > 0xFFF; 
-#endif
-                    break;
-                // this looks at the lower nibble of VX for the character.
-                // All character fonts take up 5 bytes of memory.
-                case 0x29: {
-                    uint8_t character = NIBBLE_2_BYTE(
-                            interpreter->registers[NIBBLE_2(instruction)]);
-                    interpreter->index_register = FONT_START_ADDRESS + character * 5;
-                    break;
-                }
-                // e.g. if VX stores 123, M[I] <- 1, M[I+1] <- 2, M[I+2] <- 3
-                case 0x33: {
-                    uint8_t digits = interpreter->registers[NIBBLE_2(instruction)];
-                    interpreter->memory[interpreter->index_register + 2] = digits % 10;
-                    digits /= 10;
-                    interpreter->memory[interpreter->index_register + 1] = digits % 10;
-                    digits /= 10;
-                    interpreter->memory[interpreter->index_register] = digits;
-                    break;
-                }
-                case 0x55: {
-                    for(uint8_t i = 0; i <= NIBBLE_2(instruction); i++) {
-                        interpreter->memory[interpreter->index_register + i] =
-                            interpreter->registers[i];
-                    }
-#ifdef LOAD_STORE_MODIFY_INDEX_OPTION 
-                    interpreter->index_register += NIBBLE_2(instruction);
-#endif
-                    break;
-                }
-                case 0x65:
-                    for(uint8_t i = 0; i <= NIBBLE_2(instruction); i++) {
-                        interpreter->registers[i] =
-                            interpreter->memory[interpreter->index_register + i];
-                    }
-#ifdef LOAD_STORE_MODIFY_INDEX_OPTION 
-                    interpreter->index_register += REGISTER_SIZE;
+            interpreter->program_counter = address + 2;
+        }
+
+        profile->operations[op->handler]++;
+        profile->addresses[address & (MEMORY_SIZE - 1)]++;
+        if(op->handler == OP_DRAW) {
+            uint64_t start = monotonic_ns();
+            op_draw(interpreter, op);
+            end_timing(profile, &profile->draw_sprite, start);
+        } else {
+            handlers[op->handler](interpreter, op);
+        }
+    }
+    end_timing(profile, &profile->run, run);
+}
+
+/**
+ * interpret_cycles(), writing a record of each instruction into
+ * interpreter->trace as it goes.
+ **/
+void trace_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    struct trace* trace = interpreter->trace;
+    uint64_t cycle = interpreter->cycles - cycles;
+    for(; cycles > 0; cycles--, cycle++) {
+        uint16_t address = interpreter->program_counter;
+        uint8_t before[REGISTER_SIZE];
+        memcpy(before, interpreter->registers, REGISTER_SIZE);
+        uint16_t instruction = (READ_MEMORY(interpreter, address) << 8) |
+            READ_MEMORY(interpreter, address + 1);
+        step(interpreter);
+
+        struct trace_record* record = &trace->records[trace->head++ & trace->mask];
+        record->cycle = cycle;
+        record->program_counter = address;
+        record->instruction = instruction;
+        record->index_register = interpreter->index_register;
+        record->changed = TRACE_NO_REGISTER;
+        record->value = 0;
+        if(memcmp(before, interpreter->registers, REGISTER_SIZE) != 0) {
+            uint8_t r = 0;
+            while(before[r] == interpreter->registers[r]) r++;
+            record->changed = r;
+            record->value = interpreter->registers[r];
+        }
+    }
+    publish_trace(trace);
+}
+
+/**
+ * A second core using direct threading: every operation is a label, and
+ * each one ends with its own copy of the dispatch, jumping straight to the
+ * next operation's label. Every dispatch site gets its own entry in the
+ * branch predictor, instead of all sharing the one jump a switch compiles to.
+ * Needs GCC/Clang's labels as values (`&&label`, `goto *`); without them
+ * this is the plain interpreter.
+ **/
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+void thread_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    static void* const labels[OP_COUNT] = {
+        [OP_UNDECODED] = &&do_undecoded,
+        [OP_SYSTEM] = &&do_system,
+        [OP_CLEAR] = &&do_clear,
+        [OP_RETURN] = &&do_return,
+        [OP_JUMP] = &&do_jump,
+        [OP_CALL] = &&do_call,
+        [OP_SKIP_EQUAL_IMMEDIATE] = &&do_skip_equal_immediate,
+        [OP_SKIP_NOT_EQUAL_IMMEDIATE] = &&do_skip_not_equal_immediate,
+        [OP_SKIP_EQUAL_REGISTER] = &&do_skip_equal_register,
+        [OP_SET_IMMEDIATE] = &&do_set_immediate,
+        [OP_ADD_IMMEDIATE] = &&do_add_immediate,
+        [OP_SET_REGISTER] = &&do_set_register,
+        [OP_OR] = &&do_or,
+        [OP_AND] = &&do_and,
+        [OP_XOR] = &&do_xor,
+        [OP_ADD_REGISTER] = &&do_add_register,
+        [OP_SUBTRACT] = &&do_subtract,
+        [OP_SHIFT_RIGHT] = &&do_shift_right,
+        [OP_SUBTRACT_REVERSE] = &&do_subtract_reverse,
+        [OP_SHIFT_LEFT] = &&do_shift_left,
+        [OP_SKIP_NOT_EQUAL_REGISTER] = &&do_skip_not_equal_register,
+        [OP_SET_INDEX] = &&do_set_index,
+        [OP_JUMP_OFFSET] = &&do_jump_offset,
+        [OP_RANDOM] = &&do_random,
+        [OP_DRAW] = &&do_draw,
+        [OP_SKIP_KEY] = &&do_skip_key,
+        [OP_SKIP_NOT_KEY] = &&do_skip_not_key,
+        [OP_GET_DELAY] = &&do_get_delay,
+        [OP_WAIT_KEY] = &&do_wait_key,
+        [OP_SET_DELAY] = &&do_set_delay,
+        [OP_SET_SOUND] = &&do_set_sound,
+        [OP_ADD_INDEX] = &&do_add_index,
+        [OP_FONT] = &&do_font,
+        [OP_DECIMAL] = &&do_decimal,
+        [OP_STORE] = &&do_store,
+        [OP_LOAD] = &&do_load,
+        [OP_SHIFT_RIGHT_VY] = &&do_shift_right_vy,
+        [OP_SHIFT_LEFT_VY] = &&do_shift_left_vy,
+        [OP_JUMP_OFFSET_VX] = &&do_jump_offset_vx,
+        [OP_ADD_INDEX_FLAG] = &&do_add_index_flag,
+        [OP_STORE_INCREMENT] = &&do_store_increment,
+        [OP_LOAD_INCREMENT] = &&do_load_increment,
+        [OP_STORE_INCREMENT_X] = &&do_store_increment_x,
+        [OP_LOAD_INCREMENT_X] = &&do_load_increment_x,
+        [OP_AUDIO] = &&do_audio,
+        [OP_PITCH] = &&do_pitch,
+        [OP_SCROLL_DOWN] = &&do_scroll_down,
+        [OP_SCROLL_RIGHT] = &&do_scroll_right,
+        [OP_SCROLL_LEFT] = &&do_scroll_left,
+        [OP_EXIT] = &&do_exit,
+        [OP_LOW_RESOLUTION] = &&do_low_resolution,
+        [OP_HIGH_RESOLUTION] = &&do_high_resolution,
+        [OP_BIG_FONT] = &&do_big_font,
+        [OP_SAVE_FLAGS] = &&do_save_flags,
+        [OP_LOAD_FLAGS] = &&do_load_flags,
+        [OP_SCROLL_UP] = &&do_scroll_up,
+        [OP_SAVE_RANGE] = &&do_save_range,
+        [OP_LOAD_RANGE] = &&do_load_range,
+        [OP_LONG_INDEX] = &&do_long_index,
+        [OP_PLANES] = &&do_planes,
+        [OP_UNKNOWN] = &&do_unknown
+    };
+    struct operation* op;
+    struct operation uncached;
+
+#define DISPATCH() \
+    do { \
+        if(cycles-- == 0) return; \
+        uint16_t address = interpreter->program_counter; \
+        if((address & 0x01) || address >= MEMORY_SIZE - 1) goto do_uncached; \
+        op = &interpreter->cache[address >> 1]; \
+        interpreter->program_counter = address + 2; \
+        goto *labels[op->handler]; \
+    } while(0)
+
+    DISPATCH();
+
+// first run from this slot: fill it in, then carry on as normal.
+do_undecoded: {
+    uint16_t address = interpreter->program_counter - 2;
+    interpreter->decode_operation((interpreter->memory[address] << 8) | interpreter->memory[address + 1], op);
+    goto *labels[op->handler];
+}
+// odd or last address, see step().
+do_uncached:
+    op = &uncached;
+    interpreter->decode_operation(fetch(interpreter), op);
+    goto *labels[op->handler];
+
+do_system: op_system(interpreter, op); DISPATCH();
+do_clear: op_clear(interpreter, op); DISPATCH();
+do_return: op_return(interpreter, op); DISPATCH();
+do_jump: op_jump(interpreter, op); DISPATCH();
+do_call: op_call(interpreter, op); DISPATCH();
+do_skip_equal_immediate: op_skip_equal_immediate(interpreter, op); DISPATCH();
+do_skip_not_equal_immediate: op_skip_not_equal_immediate(interpreter, op); DISPATCH();
+do_skip_equal_register: op_skip_equal_register(interpreter, op); DISPATCH();
+do_set_immediate: op_set_immediate(interpreter, op); DISPATCH();
+do_add_immediate: op_add_immediate(interpreter, op); DISPATCH();
+do_set_register: op_set_register(interpreter, op); DISPATCH();
+do_or: op_or(interpreter, op); DISPATCH();
+do_and: op_and(interpreter, op); DISPATCH();
+do_xor: op_xor(interpreter, op); DISPATCH();
+do_add_register: op_add_register(interpreter, op); DISPATCH();
+do_subtract: op_subtract(interpreter, op); DISPATCH();
+do_shift_right: op_shift_right(interpreter, op); DISPATCH();
+do_subtract_reverse: op_subtract_reverse(interpreter, op); DISPATCH();
+do_shift_left: op_shift_left(interpreter, op); DISPATCH();
+do_skip_not_equal_register: op_skip_not_equal_register(interpreter, op); DISPATCH();
+do_set_index: op_set_index(interpreter, op); DISPATCH();
+do_jump_offset: op_jump_offset(interpreter, op); DISPATCH();
+do_random: op_random(interpreter, op); DISPATCH();
+do_draw: op_draw(interpreter, op); DISPATCH();
+do_skip_key: op_skip_key(interpreter, op); DISPATCH();
+do_skip_not_key: op_skip_not_key(interpreter, op); DISPATCH();
+do_get_delay: op_get_delay(interpreter, op); DISPATCH();
+do_wait_key: op_wait_key(interpreter, op); DISPATCH();
+do_set_delay: op_set_delay(interpreter, op); DISPATCH();
+do_set_sound: op_set_sound(interpreter, op); DISPATCH();
+do_add_index: op_add_index(interpreter, op); DISPATCH();
+do_font: op_font(interpreter, op); DISPATCH();
+do_decimal: op_decimal(interpreter, op); DISPATCH();
+do_store: op_store(interpreter, op); DISPATCH();
+do_load: op_load(interpreter, op); DISPATCH();
+do_shift_right_vy: op_shift_right_vy(interpreter, op); DISPATCH();
+do_shift_left_vy: op_shift_left_vy(interpreter, op); DISPATCH();
+do_jump_offset_vx: op_jump_offset_vx(interpreter, op); DISPATCH();
+do_add_index_flag: op_add_index_flag(interpreter, op); DISPATCH();
+do_store_increment: op_store_increment(interpreter, op); DISPATCH();
+do_load_increment: op_load_increment(interpreter, op); DISPATCH();
+do_store_increment_x: op_store_increment_x(interpreter, op); DISPATCH();
+do_load_increment_x: op_load_increment_x(interpreter, op); DISPATCH();
+do_audio: op_audio(interpreter, op); DISPATCH();
+do_pitch: op_pitch(interpreter, op); DISPATCH();
+do_scroll_down: op_scroll_down(interpreter, op); DISPATCH();
+do_scroll_right: op_scroll_right(interpreter, op); DISPATCH();
+do_scroll_left: op_scroll_left(interpreter, op); DISPATCH();
+do_exit: op_exit(interpreter, op); DISPATCH();
+do_low_resolution: op_low_resolution(interpreter, op); DISPATCH();
+do_high_resolution: op_high_resolution(interpreter, op); DISPATCH();
+do_big_font: op_big_font(interpreter, op); DISPATCH();
+do_save_flags: op_save_flags(interpreter, op); DISPATCH();
+do_load_flags: op_load_flags(interpreter, op); DISPATCH();
+do_scroll_up: op_scroll_up(interpreter, op); DISPATCH();
+do_save_range: op_save_range(interpreter, op); DISPATCH();
+do_load_range: op_load_range(interpreter, op); DISPATCH();
+do_long_index: op_long_index(interpreter, op); DISPATCH();
+do_planes: op_planes(interpreter, op); DISPATCH();
+do_unknown: op_unknown(interpreter, op); DISPATCH();
+
+#undef DISPATCH
+}
+#pragma GCC diagnostic pop
+#else
+void thread_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    interpret_cycles(interpreter, cycles);
+}
 #endif
-                    break;
-                default:
-                    fprintf(stderr, "Unknown instruction %4X.\n", instruction);
-                    break;
-            }
+
+// lcm(1, ..., 8), so a loop of up to 8 instructions comes round whole in it.
+#define IDLE_PERIOD 840
+// checking for anything but a halt costs more than it saves in fewer.
+#define IDLE_MIN_CYCLES 64
+
+/**
+ * Everything an instruction could change that isn't counted in `effects`.
+ * Only the stack below the stack pointer is kept, the rest zeroed: a call in
+ * a loop writes the same entry above it each time round, and that can't be
+ * read until it is written again.
+ **/
+struct idle_state {
+    uint64_t random_state;
+    uint32_t effects;
+    uint16_t program_counter;
+    uint16_t index_register;
+    uint16_t waiting_keys;
+    uint8_t registers[REGISTER_SIZE];
+    uint8_t delay_timer;
+    uint8_t sound_timer;
+    uint8_t stack_pointer;
+    uint8_t fault;
+    uint16_t stack[STACK_MAX_DEPTH];
+};
+
+static void get_idle_state(const struct interpreter* interpreter, struct idle_state* state) {
+    memset(state, 0, sizeof(*state)); // padding included, for memcmp().
+    state->random_state = interpreter->random_state;
+    state->effects = interpreter->effects;
+    state->program_counter = interpreter->program_counter;
+    state->index_register = interpreter->index_register;
+    state->waiting_keys = interpreter->waiting_keys;
+    memcpy(state->registers, interpreter->registers, REGISTER_SIZE);
+    state->delay_timer = interpreter->delay_timer;
+    state->sound_timer = interpreter->sound_timer;
+    state->stack_pointer = interpreter->stack_pointer;
+    state->fault = interpreter->fault;
+    memcpy(state->stack, interpreter->stack, interpreter->stack_pointer * sizeof(state->stack[0]));
+}
+
+#define JUMPS_TO(instruction, address) \
+    (NIBBLE_1(instruction) == 0x1 && AFTER_NIBBLE_1(instruction) == (address))
+
+/**
+ * Instructions in one turn of a well-known idle loop at PC, starting with
+ * `first`, or 0: FX0A waiting on a key takes one, and FX07, 3X00, 1NNN back
+ * to the FX07, i.e. waiting out the delay timer, three.
+ **/
+static uint32_t idle_signature(const struct interpreter* interpreter, uint16_t first) {
+    uint16_t pc = interpreter->program_counter;
+    if((first & 0xF0FF) == 0xF00A) return 1;
+    if((first & 0xF0FF) != 0xF007) return 0;
+    uint16_t second = (READ_MEMORY(interpreter, pc + 2) << 8) | READ_MEMORY(interpreter, pc + 3);
+    uint16_t third = (READ_MEMORY(interpreter, pc + 4) << 8) | READ_MEMORY(interpreter, pc + 5);
+    return second == (0x3000 | (first & 0x0F00)) && JUMPS_TO(third, pc) ? 3 : 0;
+}
+
+static void run_engine(struct interpreter* interpreter, uint32_t cycles) {
+    switch(interpreter->engine) {
+        case ENGINE_THREADED:
+            thread_cycles(interpreter, cycles);
+            break;
+        case ENGINE_JIT:
+            jit_run_cycles(interpreter->jit, interpreter, cycles);
             break;
-        }
         default:
-            fprintf(stderr, "Unknown instruction %4X.\n", instruction);
+            interpret_cycles(interpreter, cycles);
             break;
     }
 }
 
+/**
+ * Runs `cycles` instructions, skipping those a program spends idling.
+ * Keys and timers only change between batches, so once the machine comes
+ * back round to exactly the state it was in, with nothing written, drawn or
+ * played in between, it will keep doing so every `period` instructions until
+ * the batch is over: those turns are skipped, and only what is left over is
+ * run. Known idle loops are checked one turn at a time, anything else every
+ * IDLE_PERIOD instructions. The result is the same as running every one,
+ * but the host gets back to sleeping (or the next frame) sooner.
+ * Profiles and traces see every instruction, as does anything with
+ * `skip_idle` off.
+ **/
+void run_cycles(struct interpreter* interpreter, uint32_t cycles) {
+    interpreter->cycles += cycles;
+    if(interpreter->profile != NULL) {
+        profile_cycles(interpreter, cycles);
+        return;
+    }
+    if(interpreter->trace != NULL) {
+        trace_cycles(interpreter, cycles);
+        return;
+    }
+    if(!interpreter->skip_idle) {
+        run_engine(interpreter, cycles);
+        return;
+    }
+    while(cycles > 0) {
+        // a 1NNN to itself, i.e. the program is done, changes nothing at all.
+        uint16_t pc = interpreter->program_counter;
+        uint16_t first = (READ_MEMORY(interpreter, pc) << 8) | READ_MEMORY(interpreter, pc + 1);
+        if(JUMPS_TO(first, pc)) return;
+        uint32_t period = cycles >= IDLE_MIN_CYCLES ? idle_signature(interpreter, first) : 0;
+        if(period == 0) period = IDLE_PERIOD;
+        if(cycles < 2 * period || cycles < IDLE_MIN_CYCLES) {
+            run_engine(interpreter, cycles);
+            return;
+        }
+        struct idle_state before, after;
+        get_idle_state(interpreter, &before);
+        run_engine(interpreter, period);
+        cycles -= period;
+        get_idle_state(interpreter, &after);
+        if(memcmp(&before, &after, sizeof(before)) == 0) cycles %= period;
+    }
+}
+
+#undef JUMPS_TO
+#undef IDLE_MIN_CYCLES
+#undef IDLE_PERIOD
+
 #undef NIBBLE_1_BYTE
 #undef NIBBLE_2_BYTE
 
@@ -345,6 +1386,8 @@ void decode(struct interpreter* interpreter, uint16_t instruction) {
 #undef BYTE_2
 #undef AFTER_NIBBLE_1
 
+#undef READ_MEMORY
+
 #undef GET_BIT
 #undef SET_BIT
 #undef CLEAR_BIT
@@ -0,0 +1,517 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+#include "jit.h"
+
+#if defined(__x86_64__) && (defined(__unix__) || defined(__APPLE__))
+#include <sys/mman.h>
+
+#define CODE_SIZE (1 << 20)       // bytes of executable memory.
+#define OPERATIONS_SIZE (1 << 16) // decoded operations handed to helpers.
+#define MAX_BLOCK_LENGTH 32       // instructions per block.
+// generous upper bound on the machine code for one block.
+#define MAX_BLOCK_CODE (64 * (MAX_BLOCK_LENGTH + 1))
+// memory is split into 64 pages so a write can quickly tell it hits no block.
+#define PAGE_SIZE (MEMORY_SIZE / 64)
+// a block ending in a skip also depends on the instruction after it.
+#define MAX_BLOCK_BYTES (2 * MAX_BLOCK_LENGTH + 2)
+
+#define REGISTER(i) (offsetof(struct interpreter, registers) + (i))
+#define PROGRAM_COUNTER offsetof(struct interpreter, program_counter)
+#define INDEX_REGISTER offsetof(struct interpreter, index_register)
+#define DELAY_TIMER offsetof(struct interpreter, delay_timer)
+#define SOUND_TIMER offsetof(struct interpreter, sound_timer)
+
+/**
+ * Generated code keeps the following in callee-saved registers:
+ *  rbx: struct interpreter*
+ *  r12: instructions left to run (signed)
+ *  r13: the table of blocks, indexed by CHIP-8 address
+ * Blocks jump to each other and never call each other, so the stack
+ * stays 16-byte aligned for calls out to C helpers.
+ **/
+typedef int64_t (*entry_function)(struct interpreter* interpreter, int64_t budget,
+        uint8_t** blocks, uint8_t* code);
+
+struct jit {
+    uint8_t* code;
+    size_t used;
+    size_t stubs_end; // the entry/exit/dispatch stubs live below this.
+
+    uint8_t* entry;    // sets up registers and jumps to a block.
+    uint8_t* exit;     // returns the budget left to C.
+    uint8_t* dispatch; // looks up the block at PC and jumps there.
+
+    uint8_t* blocks[MEMORY_SIZE];  // machine code for the block at each address.
+    uint8_t lengths[MEMORY_SIZE];  // CHIP-8 bytes covered by each block.
+    uint8_t counts[MEMORY_SIZE];   // instructions in each block.
+    uint64_t pages;                // bit p set when a block may cover page p.
+
+    struct operation* operations;
+    size_t operations_used;
+};
+
+static void emit8(struct jit* jit, uint8_t byte) {
+    jit->code[jit->used++] = byte;
+}
+
+static void emit16(struct jit* jit, uint16_t value) {
+    memcpy(jit->code + jit->used, &value, sizeof(value));
+    jit->used += sizeof(value);
+}
+
+static void emit32(struct jit* jit, uint32_t value) {
+    memcpy(jit->code + jit->used, &value, sizeof(value));
+    jit->used += sizeof(value);
+}
+
+static void emit64(struct jit* jit, uint64_t value) {
+    memcpy(jit->code + jit->used, &value, sizeof(value));
+    jit->used += sizeof(value);
+}
+
+static void emit_bytes(struct jit* jit, const uint8_t* bytes, size_t length) {
+    memcpy(jit->code + jit->used, bytes, length);
+    jit->used += length;
+}
+
+#define EMIT(jit, ...) emit_bytes((jit), (const uint8_t[]) {__VA_ARGS__}, \
+        sizeof((const uint8_t[]) {__VA_ARGS__}))
+
+// rel32 operand that lands on `target`, for an instruction ending right after it.
+static void emit_relative(struct jit* jit, const uint8_t* target) {
+    emit32(jit, (uint32_t) (target - (jit->code + jit->used + 4)));
+}
+
+static void emit_jump(struct jit* jit, const uint8_t* target) {
+    emit8(jit, 0xE9); // jmp rel32
+    emit_relative(jit, target);
+}
+
+// op byte(s), then a ModRM of [rbx + disp32] with the given reg field.
+static void emit_rbx_operand(struct jit* jit, uint8_t reg, size_t offset) {
+    emit8(jit, 0x83 | (reg << 3));
+    emit32(jit, (uint32_t) offset);
+}
+
+// mov al, [rbx + offset]
+static void emit_load_al(struct jit* jit, size_t offset) {
+    emit8(jit, 0x8A);
+    emit_rbx_operand(jit, 0, offset);
+}
+
+// mov dl, [rbx + offset]
+static void emit_load_dl(struct jit* jit, size_t offset) {
+    emit8(jit, 0x8A);
+    emit_rbx_operand(jit, 2, offset);
+}
+
+// mov [rbx + offset], al
+static void emit_store_al(struct jit* jit, size_t offset) {
+    emit8(jit, 0x88);
+    emit_rbx_operand(jit, 0, offset);
+}
+
+// mov [rbx + offset], dl
+static void emit_store_dl(struct jit* jit, size_t offset) {
+    emit8(jit, 0x88);
+    emit_rbx_operand(jit, 2, offset);
+}
+
+// mov [rbx + offset], cl
+static void emit_store_cl(struct jit* jit, size_t offset) {
+    emit8(jit, 0x88);
+    emit_rbx_operand(jit, 1, offset);
+}
+
+// mov word [rbx + PC], address
+static void emit_store_program_counter(struct jit* jit, uint16_t address) {
+    emit8(jit, 0x66);
+    emit8(jit, 0xC7);
+    emit_rbx_operand(jit, 0, PROGRAM_COUNTER);
+    emit16(jit, address);
+}
+
+/**
+ * Leaves the block for `target`. If that block is already translated,
+ * jump straight into it; otherwise go through the dispatcher, which will
+ * find it later (or hand back to C to translate it).
+ **/
+static void emit_exit(struct jit* jit, uint32_t target) {
+    emit_store_program_counter(jit, target);
+    uint8_t* code = target < MEMORY_SIZE ? jit->blocks[target] : NULL;
+    emit_jump(jit, code != NULL ? code : jit->dispatch);
+}
+
+/**
+ * Skips the instruction after `address` when the flags satisfy jcc, else
+ * goes on to it. How far a skip goes depends on that instruction, i.e.
+ * F000 NNNN is skipped whole, which is why translate() counts it as part
+ * of the block.
+ **/
+static void emit_conditional_exit(struct jit* jit, struct interpreter* interpreter,
+        uint8_t jcc, uint16_t address) {
+    emit8(jit, 0x0F);
+    emit8(jit, jcc);
+    size_t patch = jit->used;
+    emit32(jit, 0);
+    emit_exit(jit, address + 2);
+    uint32_t distance = (uint32_t) (jit->used - (patch + 4));
+    memcpy(jit->code + patch, &distance, sizeof(distance));
+    emit_exit(jit, address + 2 + instruction_length(interpreter, address + 2));
+}
+
+// calls the interpreter's own handler for `op`.
+static void emit_call_handler(struct jit* jit, const struct operation* op) {
+    struct operation* copy = &jit->operations[jit->operations_used++];
+    *copy = *op;
+    operation_handler handler = get_handler(op->handler);
+    uint64_t function;
+    memcpy(&function, &handler, sizeof(function));
+
+    EMIT(jit, 0x48, 0x89, 0xDF); // mov rdi, rbx
+    emit8(jit, 0x48);                                         // mov rsi, imm64
+    emit8(jit, 0xBE);
+    emit64(jit, (uint64_t) (uintptr_t) copy);
+    emit8(jit, 0x48);                                         // mov rax, imm64
+    emit8(jit, 0xB8);
+    emit64(jit, function);
+    EMIT(jit, 0xFF, 0xD0);       // call rax
+}
+
+/**
+ * Emits the code for one instruction at `address`.
+ * Returns true when the instruction ends the block, i.e. it may change
+ * the program counter or write to memory that could hold code.
+ **/
+static bool emit_operation(struct jit* jit, struct interpreter* interpreter,
+        const struct operation* op, uint16_t address) {
+    switch(op->handler) {
+        case OP_SYSTEM:
+            return false;
+        case OP_SET_IMMEDIATE:
+            emit8(jit, 0xC6); // mov byte [rbx + VX], NN
+            emit_rbx_operand(jit, 0, REGISTER(OP_X(op)));
+            emit8(jit, OP_NN(op));
+            return false;
+        case OP_ADD_IMMEDIATE:
+            emit8(jit, 0x80); // add byte [rbx + VX], NN
+            emit_rbx_operand(jit, 0, REGISTER(OP_X(op)));
+            emit8(jit, OP_NN(op));
+            return false;
+        case OP_SET_REGISTER:
+            emit_load_al(jit, REGISTER(OP_Y(op)));
+            emit_store_al(jit, REGISTER(OP_X(op)));
+            return false;
+        case OP_OR:
+        case OP_AND:
+        case OP_XOR:
+            emit_load_al(jit, REGISTER(OP_Y(op)));
+            // or / and / xor [rbx + VX], al
+            emit8(jit, op->handler == OP_OR ? 0x08 : op->handler == OP_AND ? 0x20 : 0x30);
+            emit_rbx_operand(jit, 0, REGISTER(OP_X(op)));
+            return false;
+        case OP_ADD_REGISTER:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit8(jit, 0x02); // add al, [rbx + VY]
+            emit_rbx_operand(jit, 0, REGISTER(OP_Y(op)));
+            EMIT(jit, 0x0F, 0x92, 0xC1); // setc cl
+            emit_store_al(jit, REGISTER(OP_X(op)));
+            emit_store_cl(jit, REGISTER(0xF));
+            return false;
+        case OP_SUBTRACT:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit_load_dl(jit, REGISTER(OP_Y(op)));
+            EMIT(jit, 0x38, 0xD0);       // cmp al, dl
+            EMIT(jit, 0x0F, 0x97, 0xC1); // seta cl
+            EMIT(jit, 0x28, 0xD0);       // sub al, dl
+            emit_store_al(jit, REGISTER(OP_X(op)));
+            emit_store_cl(jit, REGISTER(0xF));
+            return false;
+        case OP_SUBTRACT_REVERSE:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit_load_dl(jit, REGISTER(OP_Y(op)));
+            EMIT(jit, 0x38, 0xC2);       // cmp dl, al
+            EMIT(jit, 0x0F, 0x97, 0xC1); // seta cl
+            EMIT(jit, 0x28, 0xC2);       // sub dl, al
+            emit_store_dl(jit, REGISTER(OP_X(op)));
+            emit_store_cl(jit, REGISTER(0xF));
+            return false;
+        case OP_SET_INDEX:
+            emit8(jit, 0x66); // mov word [rbx + I], NNN
+            emit8(jit, 0xC7);
+            emit_rbx_operand(jit, 0, INDEX_REGISTER);
+            emit16(jit, OP_NNN(op));
+            return false;
+        case OP_GET_DELAY:
+            emit_load_al(jit, DELAY_TIMER);
+            emit_store_al(jit, REGISTER(OP_X(op)));
+            return false;
+        case OP_SET_DELAY:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit_store_al(jit, DELAY_TIMER);
+            return false;
+        case OP_SET_SOUND:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit_store_al(jit, SOUND_TIMER);
+            return false;
+        case OP_JUMP:
+            emit_exit(jit, OP_NNN(op));
+            return true;
+        case OP_SKIP_EQUAL_IMMEDIATE:
+        case OP_SKIP_NOT_EQUAL_IMMEDIATE:
+            emit8(jit, 0x80); // cmp byte [rbx + VX], NN
+            emit_rbx_operand(jit, 7, REGISTER(OP_X(op)));
+            emit8(jit, OP_NN(op));
+            emit_conditional_exit(jit, interpreter,
+                    op->handler == OP_SKIP_EQUAL_IMMEDIATE ? 0x84 : 0x85, address);
+            return true;
+        case OP_SKIP_EQUAL_REGISTER:
+        case OP_SKIP_NOT_EQUAL_REGISTER:
+            emit_load_al(jit, REGISTER(OP_X(op)));
+            emit8(jit, 0x3A); // cmp al, [rbx + VY]
+            emit_rbx_operand(jit, 0, REGISTER(OP_Y(op)));
+            emit_conditional_exit(jit, interpreter,
+                    op->handler == OP_SKIP_EQUAL_REGISTER ? 0x84 : 0x85, address);
+            return true;
+        // these change the program counter, or write memory, in C.
+        case OP_RETURN:
+        case OP_CALL:
+        case OP_JUMP_OFFSET:
+        case OP_JUMP_OFFSET_VX:
+        case OP_SKIP_KEY:
+        case OP_SKIP_NOT_KEY:
+        case OP_WAIT_KEY:
+        case OP_DECIMAL:
+        case OP_STORE:
+        case OP_STORE_INCREMENT:
+        case OP_STORE_INCREMENT_X:
+        case OP_SAVE_RANGE:
+        case OP_LONG_INDEX:
+        case OP_EXIT:
+            emit_store_program_counter(jit, address + 2);
+            emit_call_handler(jit, op);
+            emit_jump(jit, jit->dispatch);
+            return true;
+        default:
+            emit_call_handler(jit, op);
+            return false;
+    }
+}
+
+static void emit_stubs(struct jit* jit) {
+    jit->entry = jit->code + jit->used;
+    EMIT(jit,
+        0x53,             // push rbx
+        0x41, 0x54,       // push r12
+        0x41, 0x55,       // push r13
+        0x41, 0x56,       // push r14
+        0x41, 0x57,       // push r15 (keeps the stack 16-byte aligned)
+        0x48, 0x89, 0xFB, // mov rbx, rdi
+        0x49, 0x89, 0xF4, // mov r12, rsi
+        0x49, 0x89, 0xD5, // mov r13, rdx
+        0xFF, 0xE1        // jmp rcx
+    );
+
+    jit->exit = jit->code + jit->used;
+    EMIT(jit,
+        0x4C, 0x89, 0xE0, // mov rax, r12
+        0x41, 0x5F,       // pop r15
+        0x41, 0x5E,       // pop r14
+        0x41, 0x5D,       // pop r13
+        0x41, 0x5C,       // pop r12
+        0x5B,             // pop rbx
+        0xC3              // ret
+    );
+
+    jit->dispatch = jit->code + jit->used;
+    EMIT(jit, 0x4D, 0x85, 0xE4); // test r12, r12
+    EMIT(jit, 0x0F, 0x8E);       // jle exit
+    emit_relative(jit, jit->exit);
+    EMIT(jit, 0x0F, 0xB7);       // movzx eax, word [rbx + PC]
+    emit_rbx_operand(jit, 0, PROGRAM_COUNTER);
+    emit8(jit, 0x3D);                                         // cmp eax, MEMORY_SIZE
+    emit32(jit, MEMORY_SIZE);
+    EMIT(jit, 0x0F, 0x83);       // jae exit
+    emit_relative(jit, jit->exit);
+    EMIT(jit, 0x49, 0x8B, 0x44, 0xC5, 0x00); // mov rax, [r13 + rax*8]
+    EMIT(jit, 0x48, 0x85, 0xC0); // test rax, rax
+    EMIT(jit, 0x0F, 0x84);       // jz exit
+    emit_relative(jit, jit->exit);
+    EMIT(jit, 0xFF, 0xE0);       // jmp rax
+
+    jit->stubs_end = jit->used;
+}
+
+// Throws away every block, keeping only the stubs.
+static void flush(struct jit* jit) {
+    jit->used = jit->stubs_end;
+    jit->operations_used = 0;
+    jit->pages = 0;
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+}
+
+/**
+ * Translates the block starting at `address`.
+ * Returns NULL if not even one instruction fits before the end of memory.
+ **/
+static uint8_t* translate(struct jit* jit, struct interpreter* interpreter, uint16_t address) {
+    if(jit->used + MAX_BLOCK_CODE > CODE_SIZE ||
+            jit->operations_used + MAX_BLOCK_LENGTH > OPERATIONS_SIZE) {
+        flush(jit);
+    }
+
+    uint8_t* start = jit->code + jit->used;
+    // registered up front so that a block looping back to itself jumps directly.
+    jit->blocks[address] = start;
+    // prologue: bail out to C if the whole block doesn't fit in the budget.
+    EMIT(jit, 0x49, 0x81, 0xFC); // cmp r12, count
+    size_t count_patch = jit->used;
+    emit32(jit, 0);
+    EMIT(jit, 0x0F, 0x8C);       // jl exit
+    emit_relative(jit, jit->exit);
+    EMIT(jit, 0x49, 0x81, 0xEC); // sub r12, count
+    size_t count_patch_2 = jit->used;
+    emit32(jit, 0);
+
+    uint32_t current = address;
+    uint32_t count = 0;
+    bool ended = false;
+    bool peeks = false; // at the instruction after the block, see emit_conditional_exit().
+    while(!ended && count < MAX_BLOCK_LENGTH && current < MEMORY_SIZE - 1) {
+        uint16_t instruction = (interpreter->memory[current] << 8) |
+            interpreter->memory[current + 1];
+        struct operation op;
+        interpreter->decode_operation(instruction, &op);
+        ended = emit_operation(jit, interpreter, &op, current);
+        peeks = op.handler == OP_SKIP_EQUAL_IMMEDIATE || op.handler == OP_SKIP_NOT_EQUAL_IMMEDIATE ||
+            op.handler == OP_SKIP_EQUAL_REGISTER || op.handler == OP_SKIP_NOT_EQUAL_REGISTER;
+        current += 2;
+        count++;
+    }
+
+    if(count == 0) {
+        jit->used = start - jit->code;
+        jit->blocks[address] = NULL;
+        return NULL;
+    }
+    if(!ended) {
+        emit_exit(jit, current);
+    }
+
+    memcpy(jit->code + count_patch, &count, sizeof(count));
+    memcpy(jit->code + count_patch_2, &count, sizeof(count));
+
+    uint32_t covered = peeks && current < MEMORY_SIZE - 1 ? current + 2 : current;
+    jit->lengths[address] = covered - address;
+    jit->counts[address] = count;
+    for(uint32_t page = address / PAGE_SIZE; page <= (covered - 1) / PAGE_SIZE; page++) {
+        jit->pages |= 1ull << page;
+    }
+    return start;
+}
+
+/**
+ * Forgets every block holding the byte at `address`. Code that already
+ * jumps straight into one of them is redirected by overwriting the start
+ * of the old block with a jump to the exit, from where C translates again.
+ **/
+void jit_invalidate(struct jit* jit, uint16_t address) {
+    if(!(jit->pages & (1ull << (address / PAGE_SIZE)))) return;
+
+    uint16_t first = address >= MAX_BLOCK_BYTES - 1 ? address - (MAX_BLOCK_BYTES - 1) : 0;
+    for(uint32_t start = first; start <= address; start++) {
+        uint8_t* code = jit->blocks[start];
+        if(code == NULL || start + jit->lengths[start] <= address) continue;
+
+        code[0] = 0xE9; // jmp exit
+        uint32_t distance = (uint32_t) (jit->exit - (code + 5));
+        memcpy(code + 1, &distance, sizeof(distance));
+        jit->blocks[start] = NULL;
+    }
+}
+
+struct jit* create_jit(void) {
+    struct jit* jit = calloc(1, sizeof(struct jit));
+    if(jit == NULL) return NULL;
+
+    jit->code = mmap(NULL, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    jit->operations = calloc(OPERATIONS_SIZE, sizeof(struct operation));
+    if(jit->code == MAP_FAILED || jit->operations == NULL) {
+        if(jit->code != MAP_FAILED) munmap(jit->code, CODE_SIZE);
+        free(jit->operations);
+        free(jit);
+        return NULL;
+    }
+
+    emit_stubs(jit);
+    return jit;
+}
+
+void destroy_jit(struct jit* jit) {
+    if(jit == NULL) return;
+    munmap(jit->code, CODE_SIZE);
+    free(jit->operations);
+    free(jit);
+}
+
+/**
+ * Runs exactly `cycles` instructions. Blocks only start when the budget
+ * covers all of them; whatever is left at the end is stepped through by
+ * the interpreter so that timers tick at the same instruction as always.
+ **/
+void jit_run_cycles(struct jit* jit, struct interpreter* interpreter, uint32_t cycles) {
+    entry_function enter;
+    memcpy(&enter, &jit->entry, sizeof(enter));
+
+    int64_t budget = cycles;
+    while(budget > 0) {
+        uint32_t address = interpreter->program_counter; // wide enough for 64 KB builds.
+        uint8_t* code = NULL;
+        if(address < MEMORY_SIZE) {
+            code = jit->blocks[address];
+            if(code == NULL) {
+                code = translate(jit, interpreter, address);
+            }
+        }
+
+        if(code == NULL || jit->counts[address] > budget) {
+            interpret_cycles(interpreter, 1);
+            budget--;
+            continue;
+        }
+        budget = enter(interpreter, budget, jit->blocks, code);
+    }
+}
+
+#else
+
+struct jit* create_jit(void) {
+    return NULL;
+}
+
+void destroy_jit(struct jit* jit) {
+    (void) jit;
+}
+
+void jit_run_cycles(struct jit* jit, struct interpreter* interpreter, uint32_t cycles) {
+    (void) jit;
+    interpret_cycles(interpreter, cycles);
+}
+
+void jit_invalidate(struct jit* jit, uint16_t address) {
+    (void) jit, (void) address;
+}
+
+#endif
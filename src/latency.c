@@ -0,0 +1,114 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "scheduler.h"
+#include "latency.h"
+
+#define LATENCY_TIMEOUT_NS 1000000000ull
+#define SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+
+static uint32_t bucket_of(uint64_t value) {
+    if(value < SUB_BUCKETS) return value;
+    uint32_t exponent = 63 - __builtin_clzll(value);
+    uint32_t shift = exponent - HISTOGRAM_SUB_BITS;
+    return ((exponent - HISTOGRAM_SUB_BITS + 1) << HISTOGRAM_SUB_BITS) |
+        ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+// the middle of what falls in `bucket`.
+static uint64_t bucket_value(uint32_t bucket) {
+    if(bucket < SUB_BUCKETS) return bucket;
+    uint32_t shift = (bucket >> HISTOGRAM_SUB_BITS) - 1;
+    uint64_t low = (uint64_t) (SUB_BUCKETS | (bucket & (SUB_BUCKETS - 1))) << shift;
+    return low + ((1ull << shift) >> 1);
+}
+
+void record_histogram(struct histogram* histogram, uint64_t value) {
+    histogram->counts[bucket_of(value)]++;
+    histogram->total++;
+    if(value > histogram->max) histogram->max = value;
+}
+
+uint64_t histogram_percentile(const struct histogram* histogram, double percent) {
+    uint64_t rank = (uint64_t) (histogram->total * percent / 100.0 + 0.5);
+    if(rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for(uint32_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if(seen >= rank) {
+            uint64_t value = bucket_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return histogram->max;
+}
+
+void init_latency(struct latency* latency) {
+    memset(latency, 0, sizeof(*latency));
+    latency->stage = SPAN_COUNT;
+}
+
+void note_key_event(struct latency* latency, uint64_t age) {
+    uint64_t now = monotonic_ns();
+    if(latency->stage != SPAN_COUNT) {
+        if(now - latency->times[0] < LATENCY_TIMEOUT_NS) return;
+        latency->abandoned++;
+    }
+    latency->times[0] = now - age;
+    latency->stage = SPAN_READ;
+}
+
+// moves on to the next stage if `span` is the one being waited on.
+static void reach(struct latency* latency, uint8_t span) {
+    if(latency->stage != span) return;
+    latency->times[span + 1] = monotonic_ns();
+    latency->stage++;
+}
+
+void note_key_read(struct latency* latency) {
+    reach(latency, SPAN_READ);
+}
+
+void note_draw(struct latency* latency) {
+    reach(latency, SPAN_DRAW);
+}
+
+void note_present(struct latency* latency) {
+    if(latency->stage != SPAN_PRESENT) return;
+    uint64_t now = monotonic_ns();
+    latency->times[SPAN_TOTAL] = now;
+    for(uint8_t span = SPAN_READ; span <= SPAN_PRESENT; span++) {
+        record_histogram(&latency->spans[span], latency->times[span + 1] - latency->times[span]);
+    }
+    record_histogram(&latency->spans[SPAN_TOTAL], now - latency->times[0]);
+    latency->stage = SPAN_COUNT;
+}
+
+void report_latency(FILE* fp, const struct latency* latency) {
+    static const char* names[SPAN_COUNT] = {
+        [SPAN_READ] = "key event -> read by program",
+        [SPAN_DRAW] = "read -> next draw",
+        [SPAN_PRESENT] = "draw -> presented",
+        [SPAN_TOTAL] = "key event -> presented"
+    };
+    uint32_t count = latency->spans[SPAN_TOTAL].total;
+    fprintf(fp, "Latency of %u key events (%u never reached the screen), in ms:\n",
+            count, latency->abandoned + (latency->stage != SPAN_COUNT));
+    if(count == 0) return;
+    fprintf(fp, "\t%-30s %8s %8s %8s\n", "", "p50", "p99", "max");
+    for(uint8_t span = 0; span < SPAN_COUNT; span++) {
+        const struct histogram* histogram = &latency->spans[span];
+        fprintf(fp, "\t%-30s %8.3f %8.3f %8.3f\n", names[span],
+                histogram_percentile(histogram, 50) / 1e6,
+                histogram_percentile(histogram, 99) / 1e6,
+                histogram->max / 1e6);
+    }
+}
+
+#undef SUB_BUCKETS
+#undef LATENCY_TIMEOUT_NS
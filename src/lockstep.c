@@ -0,0 +1,466 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+#include "lockstep.h"
+
+#if defined(__GNUC__)
+
+// one element per lane.
+typedef uint8_t lane_bytes __attribute__((vector_size(LOCKSTEP_LANES)));
+typedef uint16_t lane_words __attribute__((vector_size(LOCKSTEP_LANES * 2)));
+
+#define BROADCAST(value) ((lane_bytes) {0} + (uint8_t) (value))
+#define BROADCAST_WORD(value) ((lane_words) {0} + (uint16_t) (value))
+// comparisons give 0xFF / 0x00 per lane; flags want 1 / 0.
+#define FLAG(comparison) ((lane_bytes) (comparison) & 0x01)
+
+/**
+ * Builds a copy of the vector code for AVX2 alongside the baseline (SSE2 on
+ * x86-64) one, with the loader picking between them on the running CPU.
+ * Needs ifunc support, so only Linux; elsewhere just the baseline is built.
+ **/
+#if defined(__x86_64__) && defined(__linux__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define VECTOR_TARGETS __attribute__((target_clones("avx2", "default")))
+#endif
+#endif
+#ifndef VECTOR_TARGETS
+#define VECTOR_TARGETS
+#endif
+
+#define LANE(i) (1u << (i))
+#define FOR_EACH_LANE(i, lanes) \
+    for(uint32_t left_ = (lanes), i; left_ != 0 && (i = __builtin_ctz(left_), 1); left_ &= left_ - 1)
+
+struct lockstep {
+    // state of the lanes in the group, i.e. those set in `live`.
+    lane_bytes registers[REGISTER_SIZE];
+    lane_words index_register;
+    lane_bytes delay_timer;
+    lane_bytes sound_timer;
+    lane_bytes live_flags; // 0xFF for lanes in the group.
+    uint16_t program_counter; // the same for the whole group.
+
+    uint32_t live;
+    uint32_t peeled; // running on their own, with their struct interpreter current.
+
+    struct interpreter* lanes;
+    uint32_t count;
+
+    // bytes some lane has written, which then may not match between lanes.
+    uint64_t written[MEMORY_SIZE / 64];
+    // decoded instructions, shared by all lanes while the bytes match.
+    struct operation cache[CACHE_SIZE];
+};
+
+// lane `i` joins the group, bringing its state with it.
+static void load_lane(struct lockstep* lockstep, uint32_t i) {
+    const struct interpreter* lane = &lockstep->lanes[i];
+    for(uint8_t r = 0; r < REGISTER_SIZE; r++) {
+        lockstep->registers[r][i] = lane->registers[r];
+    }
+    lockstep->index_register[i] = lane->index_register;
+    lockstep->delay_timer[i] = lane->delay_timer;
+    lockstep->sound_timer[i] = lane->sound_timer;
+}
+
+// writes lane `i`'s state in the group back to its struct interpreter.
+static void store_lane(struct lockstep* lockstep, uint32_t i) {
+    struct interpreter* lane = &lockstep->lanes[i];
+    for(uint8_t r = 0; r < REGISTER_SIZE; r++) {
+        lane->registers[r] = lockstep->registers[r][i];
+    }
+    lane->index_register = lockstep->index_register[i];
+    lane->delay_timer = lockstep->delay_timer[i];
+    lane->sound_timer = lockstep->sound_timer[i];
+    lane->program_counter = lockstep->program_counter;
+}
+
+static void set_live(struct lockstep* lockstep, uint32_t live) {
+    lockstep->live = live;
+    for(uint32_t i = 0; i < LOCKSTEP_LANES; i++) {
+        lockstep->live_flags[i] = (live & LANE(i)) ? 0xFF : 0x00;
+    }
+}
+
+/**
+ * Keeps whichever program counter most of `lanes` are at as the group's,
+ * and peels off the rest. Their counters are read from their structs,
+ * and the ones that stay are loaded back into the group.
+ **/
+static void regroup(struct lockstep* lockstep, uint32_t lanes) {
+    uint32_t best = 0;
+    uint32_t left = lanes;
+    while(left != 0 && __builtin_popcount(left) > __builtin_popcount(best)) {
+        uint16_t pc = lockstep->lanes[__builtin_ctz(left)].program_counter;
+        uint32_t same = 0;
+        FOR_EACH_LANE(i, left) {
+            if(lockstep->lanes[i].program_counter == pc) same |= LANE(i);
+        }
+        if(__builtin_popcount(same) > __builtin_popcount(best)) {
+            best = same;
+            lockstep->program_counter = pc;
+        }
+        left &= ~same;
+    }
+
+    FOR_EACH_LANE(i, best) {
+        load_lane(lockstep, i);
+    }
+    set_live(lockstep, best);
+    lockstep->peeled |= lanes & ~best;
+}
+
+// peeled lanes that have come back to the group's program counter rejoin it.
+static void rejoin(struct lockstep* lockstep) {
+    if(lockstep->peeled == 0) return;
+    if(lockstep->live == 0) {
+        uint32_t lanes = lockstep->peeled;
+        lockstep->peeled = 0;
+        regroup(lockstep, lanes);
+        return;
+    }
+
+    uint32_t joined = 0;
+    FOR_EACH_LANE(i, lockstep->peeled) {
+        if(lockstep->lanes[i].program_counter == lockstep->program_counter) {
+            load_lane(lockstep, i);
+            joined |= LANE(i);
+        }
+    }
+    if(joined != 0) {
+        lockstep->peeled &= ~joined;
+        set_live(lockstep, lockstep->live | joined);
+    }
+}
+
+static void mark_written(struct lockstep* lockstep, uint16_t address, uint16_t length) {
+    for(uint16_t i = 0; i < length; i++) {
+        uint16_t byte = (address + i) & (MEMORY_SIZE - 1);
+        lockstep->written[byte / 64] |= 1ull << (byte % 64);
+    }
+}
+
+static bool was_written(const struct lockstep* lockstep, uint16_t address) {
+    address &= MEMORY_SIZE - 1;
+    return (lockstep->written[address / 64] >> (address % 64)) & 0x01;
+}
+
+// records what `op` is about to write when run with I = `index`.
+static void note_writes(struct lockstep* lockstep, const struct operation* op, uint16_t index) {
+    switch(op->handler) {
+        case OP_DECIMAL:
+            mark_written(lockstep, index, 3);
+            break;
+        case OP_STORE:
+        case OP_STORE_INCREMENT:
+        case OP_STORE_INCREMENT_X:
+            mark_written(lockstep, index, OP_X(op) + 1);
+            break;
+        case OP_SAVE_RANGE:
+            mark_written(lockstep, index, (OP_X(op) <= OP_Y(op) ? OP_Y(op) - OP_X(op) : OP_X(op) - OP_Y(op)) + 1);
+            break;
+    }
+}
+
+static uint16_t read_instruction(const struct interpreter* lane, uint16_t address) {
+    return (lane->memory[address & (MEMORY_SIZE - 1)] << 8) |
+        lane->memory[(address + 1) & (MEMORY_SIZE - 1)];
+}
+
+// vectors are passed by pointer, as their by-value ABI depends on the target.
+static uint32_t lane_bits(const lane_bytes* flags) {
+    uint32_t bits = 0;
+    for(uint32_t i = 0; i < LOCKSTEP_LANES; i++) {
+        bits |= (uint32_t) ((*flags)[i] & 0x01) << i;
+    }
+    return bits;
+}
+
+// which lanes in the group a skip is taken for.
+static uint32_t skipping_lanes(const struct lockstep* lockstep, const lane_bytes* condition) {
+    static const lane_bytes none = {0};
+    lane_bytes taken = *condition & lockstep->live_flags;
+    if(memcmp(&taken, &none, sizeof(taken)) == 0) return 0;
+    if(memcmp(&taken, &lockstep->live_flags, sizeof(taken)) == 0) return lockstep->live;
+    return lane_bits(&taken);
+}
+
+/**
+ * Runs `op` for every lane at once, if it is one that can be.
+ * Lanes outside the group are computed too, but their results are never
+ * read: their real state is in their structs until they rejoin.
+ * @param   taken   set to the lanes that skip, for skips.
+ * @return  false if `op` has to be run lane by lane.
+ **/
+VECTOR_TARGETS
+static bool vector_operation(struct lockstep* lockstep, const struct operation* op, uint32_t* taken) {
+    lane_bytes* V = lockstep->registers;
+    lane_bytes a;
+    lane_bytes b;
+    switch(op->handler) {
+        case OP_SYSTEM:
+        case OP_JUMP:
+            return true;
+        case OP_SET_IMMEDIATE:
+            V[OP_X(op)] = BROADCAST(OP_NN(op));
+            return true;
+        case OP_ADD_IMMEDIATE:
+            V[OP_X(op)] += BROADCAST(OP_NN(op));
+            return true;
+        case OP_SET_REGISTER:
+            V[OP_X(op)] = V[OP_Y(op)];
+            return true;
+        case OP_OR:
+            V[OP_X(op)] |= V[OP_Y(op)];
+            return true;
+        case OP_AND:
+            V[OP_X(op)] &= V[OP_Y(op)];
+            return true;
+        case OP_XOR:
+            V[OP_X(op)] ^= V[OP_Y(op)];
+            return true;
+        case OP_ADD_REGISTER:
+            a = V[OP_X(op)];
+            b = a + V[OP_Y(op)];
+            V[OP_X(op)] = b;
+            V[0xF] = FLAG(b < a);
+            return true;
+        case OP_SUBTRACT:
+            a = V[OP_X(op)];
+            b = V[OP_Y(op)];
+            V[OP_X(op)] = a - b;
+            V[0xF] = FLAG(a > b);
+            return true;
+        case OP_SUBTRACT_REVERSE:
+            a = V[OP_X(op)];
+            b = V[OP_Y(op)];
+            V[OP_X(op)] = b - a;
+            V[0xF] = FLAG(b > a);
+            return true;
+        case OP_SHIFT_RIGHT:
+        case OP_SHIFT_RIGHT_VY:
+            a = op->handler == OP_SHIFT_RIGHT ? V[OP_X(op)] : V[OP_Y(op)];
+            V[OP_X(op)] = a >> 1;
+            V[0xF] = a & 0x01;
+            return true;
+        case OP_SHIFT_LEFT:
+        case OP_SHIFT_LEFT_VY:
+            a = op->handler == OP_SHIFT_LEFT ? V[OP_X(op)] : V[OP_Y(op)];
+            V[OP_X(op)] = a << 1;
+            V[0xF] = a >> 7;
+            return true;
+        case OP_SKIP_EQUAL_IMMEDIATE:
+            a = (lane_bytes) (V[OP_X(op)] == BROADCAST(OP_NN(op)));
+            *taken = skipping_lanes(lockstep, &a);
+            return true;
+        case OP_SKIP_NOT_EQUAL_IMMEDIATE:
+            a = (lane_bytes) (V[OP_X(op)] != BROADCAST(OP_NN(op)));
+            *taken = skipping_lanes(lockstep, &a);
+            return true;
+        case OP_SKIP_EQUAL_REGISTER:
+            a = (lane_bytes) (V[OP_X(op)] == V[OP_Y(op)]);
+            *taken = skipping_lanes(lockstep, &a);
+            return true;
+        case OP_SKIP_NOT_EQUAL_REGISTER:
+            a = (lane_bytes) (V[OP_X(op)] != V[OP_Y(op)]);
+            *taken = skipping_lanes(lockstep, &a);
+            return true;
+        case OP_SET_INDEX:
+            lockstep->index_register = BROADCAST_WORD(OP_NNN(op));
+            return true;
+        case OP_ADD_INDEX:
+            lockstep->index_register += __builtin_convertvector(V[OP_X(op)], lane_words);
+            return true;
+        case OP_ADD_INDEX_FLAG:
+            lockstep->index_register += __builtin_convertvector(V[OP_X(op)], lane_words);
+            V[0xF] = __builtin_convertvector(
+                    (lane_words) (lockstep->index_register > BROADCAST_WORD(0xFFF)), lane_bytes) & 0x01;
+            return true;
+        case OP_GET_DELAY:
+            V[OP_X(op)] = lockstep->delay_timer;
+            return true;
+        case OP_SET_DELAY:
+            lockstep->delay_timer = V[OP_X(op)];
+            return true;
+        case OP_SET_SOUND:
+            lockstep->sound_timer = V[OP_X(op)];
+            return true;
+        default:
+            return false;
+    }
+}
+
+// runs one instruction for a lane on its own.
+static void step_lane(struct lockstep* lockstep, uint32_t i) {
+    struct interpreter* lane = &lockstep->lanes[i];
+    struct operation op;
+    lane->decode_operation(read_instruction(lane, lane->program_counter), &op);
+    note_writes(lockstep, &op, lane->index_register);
+    interpret_cycles(lane, 1);
+}
+
+/**
+ * Runs one instruction for the group. Lanes that leave the group here
+ * have still run exactly one instruction by the time it returns.
+ **/
+static void step_group(struct lockstep* lockstep) {
+    uint16_t pc = lockstep->program_counter;
+    struct interpreter* leader = &lockstep->lanes[__builtin_ctz(lockstep->live)];
+    struct operation uncached;
+    const struct operation* op;
+
+    if((pc & 0x01) || pc >= MEMORY_SIZE - 1 || was_written(lockstep, pc) ||
+            was_written(lockstep, pc + 1)) {
+        // lanes may have different code here; any that do go their own way.
+        uint16_t instruction = read_instruction(leader, pc);
+        uint32_t differing = 0;
+        FOR_EACH_LANE(i, lockstep->live) {
+            if(read_instruction(&lockstep->lanes[i], pc) != instruction) {
+                store_lane(lockstep, i);
+                step_lane(lockstep, i);
+                differing |= LANE(i);
+            }
+        }
+        if(differing != 0) {
+            lockstep->peeled |= differing;
+            set_live(lockstep, lockstep->live & ~differing);
+        }
+        leader->decode_operation(instruction, &uncached);
+        op = &uncached;
+    } else {
+        struct operation* slot = &lockstep->cache[pc >> 1];
+        if(slot->handler == OP_UNDECODED) {
+            leader->decode_operation(read_instruction(leader, pc), slot);
+        }
+        op = slot;
+    }
+
+    uint32_t taken = 0;
+    if(vector_operation(lockstep, op, &taken)) {
+        lockstep->program_counter = op->handler == OP_JUMP ? OP_NNN(op) : pc + 2;
+        if(taken == 0) return;
+        // how far a skip goes depends on the instruction skipped, which the
+        // lanes only share while none of them wrote it.
+        bool shared = !was_written(lockstep, pc + 2) && !was_written(lockstep, pc + 3);
+        if(taken == lockstep->live && shared) {
+            lockstep->program_counter += instruction_length(leader, pc + 2);
+        } else {
+            uint32_t live = lockstep->live;
+            FOR_EACH_LANE(i, live) {
+                struct interpreter* lane = &lockstep->lanes[i];
+                store_lane(lockstep, i);
+                if(taken & LANE(i)) lane->program_counter += instruction_length(lane, pc + 2);
+            }
+            regroup(lockstep, live);
+        }
+        return;
+    }
+
+    // everything else runs lane by lane, then the group re-forms around
+    // wherever most of the lanes ended up.
+    operation_handler handler = get_handler(op->handler);
+    uint32_t live = lockstep->live;
+    FOR_EACH_LANE(i, live) {
+        struct interpreter* lane = &lockstep->lanes[i];
+        store_lane(lockstep, i);
+        lane->program_counter = pc + 2;
+        note_writes(lockstep, op, lane->index_register);
+        handler(lane, op);
+    }
+    regroup(lockstep, live);
+}
+
+struct lockstep* create_lockstep(struct interpreter* lanes, uint32_t count) {
+    if(count == 0 || count > LOCKSTEP_LANES) return NULL;
+
+    // the vectors need their natural alignment, which malloc does not promise.
+    size_t size = (sizeof(struct lockstep) + 63) & ~(size_t) 63;
+    struct lockstep* lockstep = aligned_alloc(64, size);
+    if(lockstep == NULL) return NULL;
+    memset(lockstep, 0, size);
+
+    lockstep->lanes = lanes;
+    lockstep->count = count;
+    regroup(lockstep, count == LOCKSTEP_LANES ? ~0u : LANE(count) - 1);
+    return lockstep;
+}
+
+void destroy_lockstep(struct lockstep* lockstep) {
+    free(lockstep);
+}
+
+void lockstep_run_cycles(struct lockstep* lockstep, uint32_t cycles) {
+    for(uint32_t i = 0; i < lockstep->count; i++) {
+        lockstep->lanes[i].cycles += cycles;
+    }
+    while(cycles-- > 0) {
+        // lanes that the group drops this step have already run.
+        uint32_t peeled = lockstep->peeled;
+        if(lockstep->live != 0) step_group(lockstep);
+        FOR_EACH_LANE(i, peeled) {
+            step_lane(lockstep, i);
+        }
+        rejoin(lockstep);
+    }
+}
+
+void lockstep_update_internals(struct lockstep* lockstep) {
+    for(uint32_t i = 0; i < lockstep->count; i++) {
+        struct interpreter* lane = &lockstep->lanes[i];
+        bool live = lockstep->live & LANE(i);
+        if(live) store_lane(lockstep, i);
+        update_internals(lane);
+        if(live) {
+            lockstep->delay_timer[i] = lane->delay_timer;
+            lockstep->sound_timer[i] = lane->sound_timer;
+        }
+    }
+}
+
+void lockstep_sync(struct lockstep* lockstep) {
+    FOR_EACH_LANE(i, lockstep->live) {
+        store_lane(lockstep, i);
+    }
+}
+
+#undef FOR_EACH_LANE
+#undef LANE
+#undef VECTOR_TARGETS
+#undef FLAG
+#undef BROADCAST_WORD
+#undef BROADCAST
+
+#else
+
+struct lockstep* create_lockstep(struct interpreter* lanes, uint32_t count) {
+    (void) lanes, (void) count;
+    return NULL;
+}
+
+void destroy_lockstep(struct lockstep* lockstep) {
+    (void) lockstep;
+}
+
+void lockstep_run_cycles(struct lockstep* lockstep, uint32_t cycles) {
+    (void) lockstep, (void) cycles;
+}
+
+void lockstep_update_internals(struct lockstep* lockstep) {
+    (void) lockstep;
+}
+
+void lockstep_sync(struct lockstep* lockstep) {
+    (void) lockstep;
+}
+
+#endif
@@ -3,9 +3,12 @@
  * Date modified: December 30, 2025
  **/
 #include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 #include "memory.h"
+#include "debug.h"
 
 void initialize_font(uint8_t* memory) {
     uint8_t font[] = {
@@ -30,11 +33,69 @@ void initialize_font(uint8_t* memory) {
     for(uint32_t i = 0; i < sizeof(font)/sizeof(font[0]); i++) {
         memory[FONT_START_ADDRESS + i] = font[i];
     }
+
+    // 10 rows a digit; SUPER-CHIP only had 0 to 9, XO-CHIP added A to F.
+    uint8_t big_font[] = {
+        0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, // 0
+        0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, // 1
+        0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, // 2
+        0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, // 3
+        0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, // 4
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, // 5
+        0x3E, 0x7C, 0xE0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, // 6
+        0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, // 7
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, // 8
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, // 9
+        0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, // A
+        0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, // B
+        0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C, // C
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, // D
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, // E
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0  // F
+    };
+
+    for(uint32_t i = 0; i < sizeof(big_font)/sizeof(big_font[0]); i++) {
+        memory[BIG_FONT_START_ADDRESS + i] = big_font[i];
+    }
 }
 
-ssize_t load_code(uint8_t* memory, int fd) {
-    ssize_t bytes = 0;
-    while((bytes = read(fd, memory + START_ADDRESS + bytes, MEMORY_SIZE - START_ADDRESS)) > 0);
+/**
+ * Reads a ROM into memory at START_ADDRESS, for files that can't be mapped
+ * (e.g. pipes). Once memory is full the rest is read and thrown away, so
+ * that `size` and `hash` cover the whole ROM as map_code()'s do.
+ * @return  the bytes loaded, or -1 on a failure to read
+ **/
+ssize_t load_code(uint8_t* memory, int fd, size_t* size, uint64_t* hash) {
+    size_t loaded = 0;
+    while(loaded < MEMORY_SIZE - START_ADDRESS) {
+        ssize_t bytes = read(fd, memory + START_ADDRESS + loaded, MEMORY_SIZE - START_ADDRESS - loaded);
+        if(bytes < 0) return -1;
+        if(bytes == 0) break;
+        loaded += bytes;
+    }
+    *size = loaded;
+    *hash = hash_bytes(memory + START_ADDRESS, loaded);
+
+    uint8_t rest[4096];
+    ssize_t bytes;
+    while((bytes = read(fd, rest, sizeof(rest))) > 0) {
+        *size += bytes;
+        *hash = hash_more(*hash, rest, bytes);
+    }
+    return bytes < 0 ? -1 : (ssize_t) loaded;
+}
 
-    return bytes;
+/**
+ * Maps a `size` byte ROM and copies what fits into memory at START_ADDRESS,
+ * hashing the whole file on the way (see hash_bytes()).
+ * @return  the bytes copied, or -1 if the file can't be mapped
+ **/
+ssize_t map_code(uint8_t* memory, int fd, size_t size, uint64_t* hash) {
+    const uint8_t* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(map == MAP_FAILED) return -1;
+    size_t loaded = size < MEMORY_SIZE - START_ADDRESS ? size : MEMORY_SIZE - START_ADDRESS;
+    memcpy(memory + START_ADDRESS, map, loaded);
+    *hash = hash_bytes(map, size);
+    munmap((void*) map, size);
+    return loaded;
 }
@@ -0,0 +1,200 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "settings.h"
+#include "platform.h"
+#include "movie.h"
+
+#define MAGIC "CH8M"
+#define VERSION 3
+// where the cycle count sits in the file, to fill in once recording ends.
+#define CYCLES_OFFSET (4 + 1 + 1 + 1 + 4 + 8 + 8)
+
+static void put_bytes(FILE* fp, uint64_t value, uint8_t bytes) {
+    for(uint8_t i = 0; i < bytes; i++) {
+        fputc((value >> (8 * i)) & 0xFF, fp);
+    }
+}
+
+static bool get_bytes(FILE* fp, uint64_t* value, uint8_t bytes) {
+    *value = 0;
+    for(uint8_t i = 0; i < bytes; i++) {
+        int c = fgetc(fp);
+        if(c == EOF) return false;
+        *value |= (uint64_t) c << (8 * i);
+    }
+    return true;
+}
+
+static void put_varint(FILE* fp, uint64_t value) {
+    while(value >= 0x80) {
+        fputc((value & 0x7F) | 0x80, fp);
+        value >>= 7;
+    }
+    fputc(value, fp);
+}
+
+static bool get_varint(FILE* fp, uint64_t* value) {
+    *value = 0;
+    for(uint8_t shift = 0; shift < 64; shift += 7) {
+        int c = fgetc(fp);
+        if(c == EOF) return false;
+        *value |= (uint64_t) (c & 0x7F) << shift;
+        if((c & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+bool record_movie(struct movie* movie, const char* filename,
+        const struct movie_header* header, const struct platform* source, const uint64_t* cycles) {
+    *movie = (struct movie) {
+        .header = *header,
+        .cycles = cycles,
+        .source = source
+    };
+    movie->fp = fopen(filename, "wb");
+    if(movie->fp == NULL) {
+        fprintf(stderr, "Failure in writing '%s'\n", filename);
+        return false;
+    }
+
+    fputs(MAGIC, movie->fp);
+    put_bytes(movie->fp, VERSION, 1);
+    put_bytes(movie->fp, header->quirks, 1);
+    put_bytes(movie->fp, header->stack_depth, 1);
+    put_bytes(movie->fp, header->frequency, 4);
+    put_bytes(movie->fp, header->seed, 8);
+    put_bytes(movie->fp, header->rom_hash, 8);
+    put_bytes(movie->fp, 0, 8); // cycles, see finish_movie().
+    return true;
+}
+
+// reads the next change, if there is one.
+static void read_ahead(struct movie* movie) {
+    uint64_t delta;
+    uint64_t keys;
+    movie->pending = get_varint(movie->fp, &delta) && get_bytes(movie->fp, &keys, 2);
+    if(movie->pending) {
+        movie->pending_cycle = movie->last_cycle + delta;
+        movie->pending_keys = keys;
+    }
+}
+
+// applies every change that is due by now.
+static void apply_changes(struct movie* movie) {
+    while(movie->pending && movie->pending_cycle <= *movie->cycles) {
+        movie->keys = movie->pending_keys;
+        movie->last_cycle = movie->pending_cycle;
+        read_ahead(movie);
+    }
+}
+
+bool replay_movie(struct movie* movie, const char* filename, const uint64_t* cycles) {
+    *movie = (struct movie) {.cycles = cycles};
+    movie->fp = fopen(filename, "rb");
+    if(movie->fp == NULL) {
+        fprintf(stderr, "Failure in reading '%s'\n", filename);
+        return false;
+    }
+
+    char magic[4];
+    uint64_t version, quirks, stack_depth, frequency;
+    struct movie_header* header = &movie->header;
+    if(fread(magic, 1, sizeof(magic), movie->fp) != sizeof(magic) ||
+            memcmp(magic, MAGIC, sizeof(magic)) != 0 ||
+            !get_bytes(movie->fp, &version, 1) || version != VERSION ||
+            !get_bytes(movie->fp, &quirks, 1) ||
+            !get_bytes(movie->fp, &stack_depth, 1) ||
+            !get_bytes(movie->fp, &frequency, 4) ||
+            !get_bytes(movie->fp, &header->seed, 8) ||
+            !get_bytes(movie->fp, &header->rom_hash, 8) ||
+            !get_bytes(movie->fp, &header->cycles, 8)) {
+        fprintf(stderr, "'%s' is not a movie this version can play\n", filename);
+        fclose(movie->fp);
+        movie->fp = NULL;
+        return false;
+    }
+    header->quirks = quirks;
+    header->stack_depth = stack_depth;
+    header->frequency = frequency;
+
+    read_ahead(movie);
+    apply_changes(movie);
+    return true;
+}
+
+bool finish_movie(struct movie* movie) {
+    if(movie->fp == NULL) return false;
+
+    bool ok = true;
+    if(movie->source != NULL) {
+        ok = fseek(movie->fp, CYCLES_OFFSET, SEEK_SET) == 0;
+        put_bytes(movie->fp, *movie->cycles, 8);
+        ok = ok && !ferror(movie->fp);
+    }
+    ok = fclose(movie->fp) == 0 && ok;
+    movie->fp = NULL;
+    if(!ok) {
+        fprintf(stderr, "Failure in writing the movie\n");
+    }
+    return ok;
+}
+
+/**
+ * The keypad is only sampled here, once a frame, and the program sees that
+ * sample until the next frame, so what was recorded is exactly what it saw.
+ **/
+static bool record_handle_events(void* userdata) {
+    struct movie* movie = userdata;
+    const struct platform* source = movie->source;
+    if(!source->handle_events(source->userdata)) return false;
+
+    uint16_t keys = source->read_keys(source->userdata);
+    if(keys != movie->keys) {
+        put_varint(movie->fp, *movie->cycles - movie->last_cycle);
+        put_bytes(movie->fp, keys, 2);
+        movie->last_cycle = *movie->cycles;
+        movie->keys = keys;
+    }
+    return true;
+}
+
+static void record_draw_display(void* userdata, const struct display* display) {
+    const struct platform* source = ((struct movie*) userdata)->source;
+    source->draw_display(source->userdata, display);
+}
+
+static void record_play_sound(void* userdata, uint8_t timer_value,
+        const struct sound_pattern* pattern) {
+    const struct platform* source = ((struct movie*) userdata)->source;
+    source->play_sound(source->userdata, timer_value, pattern);
+}
+
+static bool replay_handle_events(void* userdata) {
+    apply_changes(userdata);
+    return true;
+}
+
+static uint16_t movie_read_keys(void* userdata) {
+    return ((const struct movie*) userdata)->keys;
+}
+
+struct platform movie_platform(struct movie* movie) {
+    struct platform platform = headless_platform;
+    platform.userdata = movie;
+    platform.read_keys = movie_read_keys;
+    if(movie->source != NULL) {
+        platform.handle_events = record_handle_events;
+        platform.draw_display = record_draw_display;
+        platform.play_sound = record_play_sound;
+    } else {
+        platform.handle_events = replay_handle_events;
+    }
+    return platform;
+}
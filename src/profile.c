@@ -0,0 +1,210 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+#include "scheduler.h"
+#include "profile.h"
+
+#define HOTTEST 20 // addresses listed in the text report.
+
+static const char* operation_names[OP_COUNT] = {
+    [OP_UNDECODED] = "undecoded",
+    [OP_SYSTEM] = "0NNN system",
+    [OP_CLEAR] = "00E0 clear",
+    [OP_RETURN] = "00EE return",
+    [OP_JUMP] = "1NNN jump",
+    [OP_CALL] = "2NNN call",
+    [OP_SKIP_EQUAL_IMMEDIATE] = "3XNN skip if equal",
+    [OP_SKIP_NOT_EQUAL_IMMEDIATE] = "4XNN skip if not equal",
+    [OP_SKIP_EQUAL_REGISTER] = "5XY0 skip if equal",
+    [OP_SET_IMMEDIATE] = "6XNN set",
+    [OP_ADD_IMMEDIATE] = "7XNN add",
+    [OP_SET_REGISTER] = "8XY0 set",
+    [OP_OR] = "8XY1 or",
+    [OP_AND] = "8XY2 and",
+    [OP_XOR] = "8XY3 xor",
+    [OP_ADD_REGISTER] = "8XY4 add",
+    [OP_SUBTRACT] = "8XY5 subtract",
+    [OP_SHIFT_RIGHT] = "8XY6 shift right",
+    [OP_SUBTRACT_REVERSE] = "8XY7 subtract reverse",
+    [OP_SHIFT_LEFT] = "8XYE shift left",
+    [OP_SKIP_NOT_EQUAL_REGISTER] = "9XY0 skip if not equal",
+    [OP_SET_INDEX] = "ANNN set index",
+    [OP_JUMP_OFFSET] = "BNNN jump with offset",
+    [OP_RANDOM] = "CXNN random",
+    [OP_DRAW] = "DXYN draw",
+    [OP_SKIP_KEY] = "EX9E skip if key",
+    [OP_SKIP_NOT_KEY] = "EXA1 skip if not key",
+    [OP_GET_DELAY] = "FX07 get delay",
+    [OP_WAIT_KEY] = "FX0A wait for key",
+    [OP_SET_DELAY] = "FX15 set delay",
+    [OP_SET_SOUND] = "FX18 set sound",
+    [OP_ADD_INDEX] = "FX1E add to index",
+    [OP_FONT] = "FX29 font",
+    [OP_DECIMAL] = "FX33 decimal",
+    [OP_STORE] = "FX55 store",
+    [OP_LOAD] = "FX65 load",
+    [OP_SHIFT_RIGHT_VY] = "8XY6 shift VY right",
+    [OP_SHIFT_LEFT_VY] = "8XYE shift VY left",
+    [OP_JUMP_OFFSET_VX] = "BXNN jump with offset",
+    [OP_ADD_INDEX_FLAG] = "FX1E add to index",
+    [OP_STORE_INCREMENT] = "FX55 store",
+    [OP_LOAD_INCREMENT] = "FX65 load",
+    [OP_STORE_INCREMENT_X] = "FX55 store",
+    [OP_LOAD_INCREMENT_X] = "FX65 load",
+    [OP_AUDIO] = "F002 audio",
+    [OP_PITCH] = "FX3A pitch",
+    [OP_SCROLL_DOWN] = "00CN scroll down",
+    [OP_SCROLL_RIGHT] = "00FB scroll right",
+    [OP_SCROLL_LEFT] = "00FC scroll left",
+    [OP_EXIT] = "00FD exit",
+    [OP_LOW_RESOLUTION] = "00FE low resolution",
+    [OP_HIGH_RESOLUTION] = "00FF high resolution",
+    [OP_BIG_FONT] = "FX30 big font",
+    [OP_SAVE_FLAGS] = "FX75 save flags",
+    [OP_LOAD_FLAGS] = "FX85 load flags",
+    [OP_SCROLL_UP] = "00DN scroll up",
+    [OP_SAVE_RANGE] = "5XY2 save range",
+    [OP_LOAD_RANGE] = "5XY3 load range",
+    [OP_LONG_INDEX] = "F000 long index",
+    [OP_PLANES] = "FN01 planes",
+    [OP_UNKNOWN] = "unknown"
+};
+
+void init_profile(struct profile* profile) {
+    memset(profile, 0, sizeof(*profile));
+    // the cheapest of a few back-to-back reads is what the clock itself costs.
+    profile->clock_ns = UINT64_MAX;
+    for(int i = 0; i < 100; i++) {
+        uint64_t start = monotonic_ns();
+        uint64_t elapsed = monotonic_ns() - start;
+        if(elapsed < profile->clock_ns) profile->clock_ns = elapsed;
+    }
+    profile->start_ns = monotonic_ns();
+}
+
+void end_timing(const struct profile* profile, struct timing* timing, uint64_t start) {
+    uint64_t elapsed = monotonic_ns() - start;
+    timing->calls++;
+    timing->ns += elapsed > profile->clock_ns ? elapsed - profile->clock_ns : 0;
+}
+
+static bool ends_with(const char* string, const char* suffix) {
+    size_t length = strlen(string);
+    size_t suffix_length = strlen(suffix);
+    return length >= suffix_length && strcmp(string + length - suffix_length, suffix) == 0;
+}
+
+static double per_second(uint64_t count, uint64_t ns) {
+    return ns != 0 ? count * 1e9 / ns : 0.0;
+}
+
+static void write_csv(FILE* fp, const struct profile* profile, uint64_t cycles, uint64_t wall) {
+    fprintf(fp, "kind,name,count,ns\n");
+    fprintf(fp, "total,instructions,%llu,%llu\n",
+            (unsigned long long) cycles, (unsigned long long) wall);
+    const struct {
+        const char* name;
+        const struct timing* timing;
+    } timings[] = {
+        {"run", &profile->run},
+        {"decode", &profile->decode},
+        {"draw_sprite", &profile->draw_sprite},
+        {"draw_display", &profile->draw_display}
+    };
+    for(size_t i = 0; i < sizeof(timings) / sizeof(timings[0]); i++) {
+        fprintf(fp, "timing,%s,%llu,%llu\n", timings[i].name,
+                (unsigned long long) timings[i].timing->calls,
+                (unsigned long long) timings[i].timing->ns);
+    }
+    for(uint8_t type = 0; type < OP_COUNT; type++) {
+        if(profile->operations[type] == 0) continue;
+        fprintf(fp, "operation,%s,%llu,\n", operation_names[type],
+                (unsigned long long) profile->operations[type]);
+    }
+    for(uint32_t address = 0; address < MEMORY_SIZE; address++) {
+        if(profile->addresses[address] == 0) continue;
+        fprintf(fp, "address,%03X,%llu,\n", address,
+                (unsigned long long) profile->addresses[address]);
+    }
+}
+
+static void write_timing(FILE* fp, const char* name, const struct timing* timing,
+        const struct profile* profile) {
+    fprintf(fp, "\t%-14s %10.3f ms %5.1f%% %12llu calls\n", name, timing->ns / 1e6,
+            profile->run.ns != 0 ? 100.0 * timing->ns / profile->run.ns : 0.0,
+            (unsigned long long) timing->calls);
+}
+
+static void write_text(FILE* fp, const struct profile* profile, uint64_t cycles, uint64_t wall) {
+    fprintf(fp, "%llu instructions in %.3f s\n", (unsigned long long) cycles, wall / 1e9);
+    fprintf(fp, "\temulated: %14.0f per second\n", per_second(cycles, wall));
+    fprintf(fp, "\thost:     %14.0f per second spent running\n",
+            per_second(cycles, profile->run.ns));
+
+    fprintf(fp, "\nTime, as a share of running:\n");
+    write_timing(fp, "running", &profile->run, profile);
+    write_timing(fp, "decode", &profile->decode, profile);
+    write_timing(fp, "draw_sprite", &profile->draw_sprite, profile);
+    write_timing(fp, "draw_display", &profile->draw_display, profile);
+
+    fprintf(fp, "\nInstructions:\n");
+    for(uint8_t type = 0; type < OP_COUNT; type++) {
+        if(profile->operations[type] == 0) continue;
+        fprintf(fp, "\t%-24s %12llu %5.1f%%\n", operation_names[type],
+                (unsigned long long) profile->operations[type],
+                100.0 * profile->operations[type] / cycles);
+    }
+
+    // picks out the hottest by selection, skipping those already listed.
+    fprintf(fp, "\nHottest addresses:\n");
+    uint64_t previous = UINT64_MAX;
+    uint32_t previous_address = 0;
+    for(int i = 0; i < HOTTEST; i++) {
+        uint64_t best = 0;
+        uint32_t best_address = 0;
+        for(uint32_t address = 0; address < MEMORY_SIZE; address++) {
+            uint64_t count = profile->addresses[address];
+            bool listed = count > previous || (count == previous && address <= previous_address);
+            if(!listed && count > best) {
+                best = count;
+                best_address = address;
+            }
+        }
+        if(best == 0) break;
+        fprintf(fp, "\t%03X %12llu %5.1f%%\n", best_address,
+                (unsigned long long) best, 100.0 * best / cycles);
+        previous = best;
+        previous_address = best_address;
+    }
+}
+
+bool write_profile(const struct profile* profile, const char* filename) {
+    FILE* fp = fopen(filename, "w");
+    if(fp == NULL) {
+        fprintf(stderr, "Unable to write the profile to '%s'\n", filename);
+        return false;
+    }
+    uint64_t wall = monotonic_ns() - profile->start_ns;
+    uint64_t cycles = 0;
+    for(uint8_t type = 0; type < OP_COUNT; type++) {
+        cycles += profile->operations[type];
+    }
+    if(ends_with(filename, ".csv")) {
+        write_csv(fp, profile, cycles, wall);
+    } else {
+        write_text(fp, profile, cycles, wall);
+    }
+    fclose(fp);
+    return true;
+}
+
+#undef HOTTEST
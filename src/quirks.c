@@ -0,0 +1,38 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "quirks.h"
+
+const struct quirk_profile quirk_profiles[] = {
+    // the original interpreter.
+    {"vip", QUIRK_SHIFT_VY | QUIRK_INDEX_INCREMENT},
+    // HP-48 calculators; the load/store increment was off by one.
+    {"chip48", QUIRK_JUMP_VX | QUIRK_INDEX_INCREMENT_X},
+    {"schip", QUIRK_JUMP_VX},
+    // what most ROMs written today expect, and this emulator's default.
+    {"modern", 0},
+    {NULL, 0}
+};
+
+bool parse_quirks(const char* name, uint8_t* quirks) {
+    for(const struct quirk_profile* profile = quirk_profiles; profile->name != NULL; profile++) {
+        if(strcmp(profile->name, name) == 0) {
+            *quirks = profile->quirks;
+            return true;
+        }
+    }
+
+    char* end;
+    unsigned long value = strtoul(name, &end, 0);
+    if(*name == '\0' || *end != '\0' || value >= QUIRK_COMBINATIONS) {
+        return false;
+    }
+    *quirks = value;
+    return true;
+}
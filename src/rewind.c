@@ -0,0 +1,266 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "settings.h"
+#include "memory.h"
+#include "interpret.h"
+#include "rewind.h"
+
+/**
+ * A snapshot in the buffer is this header, then the old contents of each
+ * page set in `pages`, then of each row set in `rows` (every plane's words
+ * of it, see copy_row()), then `stack_entries`
+ * (index, value) pairs of uint16_t, padded out to a multiple of 8 bytes.
+ **/
+struct snapshot {
+    struct machine_state state;
+    uint16_t pages;
+    uint16_t stack_entries;
+    uint64_t rows;
+};
+
+#define ALIGN(size) (((size) + 7) & ~(size_t) 7)
+#define ROW_SIZE (ROW_WORDS * sizeof(uint64_t))
+#define SNAPSHOT_ROW_SIZE (DISPLAY_PLANES * ROW_SIZE)
+
+static void get_state(struct machine_state* state, const struct interpreter* interpreter) {
+    memcpy(state->registers, interpreter->registers, REGISTER_SIZE);
+    state->program_counter = interpreter->program_counter;
+    state->index_register = interpreter->index_register;
+    state->stack_pointer = interpreter->stack_pointer;
+    state->delay_timer = interpreter->delay_timer;
+    state->sound_timer = interpreter->sound_timer;
+    state->fault = interpreter->fault;
+    state->keys = interpreter->keys;
+    state->waiting_keys = interpreter->waiting_keys;
+    state->random_state = interpreter->random_state;
+    state->cycles = interpreter->cycles;
+    state->sound = interpreter->sound;
+    state->has_pattern = interpreter->has_pattern;
+    state->hires = interpreter->display.hires;
+    state->planes = interpreter->planes;
+    memcpy(state->flags, interpreter->flags, REGISTER_SIZE);
+}
+
+static void set_state(struct interpreter* interpreter, const struct machine_state* state) {
+    memcpy(interpreter->registers, state->registers, REGISTER_SIZE);
+    interpreter->program_counter = state->program_counter;
+    interpreter->index_register = state->index_register;
+    interpreter->stack_pointer = state->stack_pointer;
+    interpreter->delay_timer = state->delay_timer;
+    interpreter->sound_timer = state->sound_timer;
+    interpreter->fault = state->fault;
+    interpreter->keys = state->keys;
+    interpreter->waiting_keys = state->waiting_keys;
+    interpreter->random_state = state->random_state;
+    interpreter->cycles = state->cycles;
+    interpreter->sound = state->sound;
+    interpreter->has_pattern = state->has_pattern;
+    interpreter->display.hires = state->hires;
+    interpreter->planes = state->planes;
+    memcpy(interpreter->flags, state->flags, REGISTER_SIZE);
+}
+
+static bool row_changed(const struct display* a, const struct display* b, uint32_t row) {
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        if(memcmp(a->planes[plane][row], b->planes[plane][row], ROW_SIZE) != 0) return true;
+    }
+    return false;
+}
+
+// writes out row `row` of every plane in `old`, then brings it up to `new`.
+static void save_row(uint8_t* out, struct display* old, const struct display* new, uint32_t row) {
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        memcpy(out + plane * ROW_SIZE, old->planes[plane][row], ROW_SIZE);
+        memcpy(old->planes[plane][row], new->planes[plane][row], ROW_SIZE);
+    }
+}
+
+static void set_row(struct display* display, const uint8_t* in, uint32_t row) {
+    for(uint8_t plane = 0; plane < DISPLAY_PLANES; plane++) {
+        memcpy(display->planes[plane][row], in + plane * ROW_SIZE, ROW_SIZE);
+    }
+}
+
+/**
+ * Stack entries at or above the pointer can't be read without being pushed
+ * over first, so only those below either pointer are compared.
+ **/
+static uint8_t live_stack(uint8_t old_pointer, uint8_t new_pointer) {
+    return old_pointer > new_pointer ? old_pointer : new_pointer;
+}
+
+bool init_rewind(struct rewind* rewind, struct interpreter* interpreter) {
+    *rewind = (struct rewind) {0};
+    rewind->buffer = malloc(REWIND_BUFFER_SIZE);
+    rewind->offsets = malloc(REWIND_FRAMES * sizeof(rewind->offsets[0]));
+    if(rewind->buffer == NULL || rewind->offsets == NULL) {
+        fprintf(stderr, "Failure in allocating the rewind buffer\n");
+        destroy_rewind(rewind);
+        return false;
+    }
+
+    get_state(&rewind->state, interpreter);
+    memcpy(rewind->memory, interpreter->memory, MEMORY_SIZE);
+    rewind->display = interpreter->display;
+    memcpy(rewind->stack, interpreter->stack, sizeof(rewind->stack));
+    interpreter->changed_rows = 0;
+    interpreter->dirty_pages = 0;
+    return true;
+}
+
+void destroy_rewind(struct rewind* rewind) {
+    free(rewind->buffer);
+    free(rewind->offsets);
+    *rewind = (struct rewind) {0};
+}
+
+// position `i` snapshots on from the oldest in rewind->offsets.
+static size_t slot(const struct rewind* rewind, size_t i) {
+    size_t index = rewind->first + i;
+    return index < REWIND_FRAMES ? index : index - REWIND_FRAMES;
+}
+
+static void drop_oldest(struct rewind* rewind) {
+    rewind->first = slot(rewind, 1);
+    if(--rewind->count == 0) {
+        rewind->first = 0;
+        rewind->end = 0;
+    }
+}
+
+/**
+ * Finds room for `size` bytes right after the newest snapshot, or at the
+ * start of the buffer if it would run off the end, dropping the oldest
+ * snapshots until they are out of the way.
+ **/
+static size_t reserve(struct rewind* rewind, size_t size) {
+    if(rewind->count == REWIND_FRAMES) drop_oldest(rewind);
+    while(rewind->count != 0) {
+        size_t oldest = rewind->offsets[rewind->first];
+        if(oldest < rewind->end) {
+            // free space is after the newest and before the oldest.
+            if(rewind->end + size <= REWIND_BUFFER_SIZE) return rewind->end;
+            if(size <= oldest) return 0;
+        } else if(rewind->end + size <= oldest) {
+            // wrapped around: free space is between the newest and the oldest.
+            return rewind->end;
+        }
+        drop_oldest(rewind);
+    }
+    return 0;
+}
+
+/**
+ * Called once a frame. What the frame changed is found through
+ * interpreter->dirty_pages and changed_rows, then stack entries by comparing
+ * with the copy kept from the last snapshot.
+ **/
+void save_snapshot(struct rewind* rewind, struct interpreter* interpreter) {
+    struct snapshot snapshot = {
+        .state = rewind->state,
+        .pages = interpreter->dirty_pages
+    };
+    for(uint64_t rows = interpreter->changed_rows; rows != 0; rows &= rows - 1) {
+        uint32_t row = __builtin_ctzll(rows);
+        snapshot.rows |= (uint64_t) row_changed(&interpreter->display, &rewind->display, row) << row;
+    }
+    uint8_t live = live_stack(rewind->state.stack_pointer, interpreter->stack_pointer);
+    for(uint8_t i = 0; i < live; i++) {
+        snapshot.stack_entries += interpreter->stack[i] != rewind->stack[i];
+    }
+
+    size_t size = ALIGN(sizeof(snapshot) +
+            __builtin_popcount(snapshot.pages) * MEMORY_PAGE_SIZE +
+            __builtin_popcountll(snapshot.rows) * SNAPSHOT_ROW_SIZE +
+            snapshot.stack_entries * 2 * sizeof(uint16_t));
+    size_t offset = reserve(rewind, size);
+    rewind->offsets[slot(rewind, rewind->count++)] = offset;
+    rewind->end = offset + size;
+
+    // write out the old contents while bringing the copy up to date.
+    uint8_t* out = rewind->buffer + offset;
+    memcpy(out, &snapshot, sizeof(snapshot));
+    out += sizeof(snapshot);
+    for(uint16_t pages = snapshot.pages; pages != 0; pages &= pages - 1) {
+        size_t start = __builtin_ctz(pages) * MEMORY_PAGE_SIZE;
+        memcpy(out, rewind->memory + start, MEMORY_PAGE_SIZE);
+        memcpy(rewind->memory + start, interpreter->memory + start, MEMORY_PAGE_SIZE);
+        out += MEMORY_PAGE_SIZE;
+    }
+    for(uint64_t rows = snapshot.rows; rows != 0; rows &= rows - 1) {
+        uint32_t row = __builtin_ctzll(rows);
+        save_row(out, &rewind->display, &interpreter->display, row);
+        out += SNAPSHOT_ROW_SIZE;
+    }
+    for(uint8_t i = 0; i < live; i++) {
+        if(interpreter->stack[i] == rewind->stack[i]) continue;
+        uint16_t entry[2] = {i, rewind->stack[i]};
+        memcpy(out, entry, sizeof(entry));
+        rewind->stack[i] = interpreter->stack[i];
+        out += sizeof(entry);
+    }
+
+    get_state(&rewind->state, interpreter);
+    interpreter->changed_rows = 0;
+    interpreter->dirty_pages = 0;
+}
+
+bool rewind_snapshot(struct rewind* rewind, struct interpreter* interpreter) {
+    if(rewind->count == 0) return false;
+    size_t offset = rewind->offsets[slot(rewind, rewind->count - 1)];
+    const uint8_t* in = rewind->buffer + offset;
+    struct snapshot snapshot;
+    memcpy(&snapshot, in, sizeof(snapshot));
+    in += sizeof(snapshot);
+
+    // memory goes through write_memory() so that no stale decodes survive.
+    for(uint16_t pages = snapshot.pages; pages != 0; pages &= pages - 1) {
+        size_t start = __builtin_ctz(pages) * MEMORY_PAGE_SIZE;
+        memcpy(rewind->memory + start, in, MEMORY_PAGE_SIZE);
+        for(size_t i = 0; i < MEMORY_PAGE_SIZE; i++) {
+            write_memory(interpreter, start + i, in[i]);
+        }
+        in += MEMORY_PAGE_SIZE;
+    }
+    for(uint64_t rows = snapshot.rows; rows != 0; rows &= rows - 1) {
+        uint32_t row = __builtin_ctzll(rows);
+        set_row(&rewind->display, in, row);
+        set_row(&interpreter->display, in, row);
+        in += SNAPSHOT_ROW_SIZE;
+    }
+    interpreter->dirty_rows |= snapshot.rows;
+    if(snapshot.state.hires != interpreter->display.hires) interpreter->dirty_rows = ~0ull;
+    for(uint16_t i = 0; i < snapshot.stack_entries; i++) {
+        uint16_t entry[2];
+        memcpy(entry, in, sizeof(entry));
+        rewind->stack[entry[0]] = entry[1];
+        interpreter->stack[entry[0]] = entry[1];
+        in += sizeof(entry);
+    }
+
+    rewind->state = snapshot.state;
+    set_state(interpreter, &snapshot.state);
+    interpreter->changed_rows = 0;
+    interpreter->dirty_pages = 0;
+
+    if(--rewind->count == 0) {
+        rewind->first = 0;
+        rewind->end = 0;
+    } else {
+        rewind->end = offset;
+    }
+    return true;
+}
+
+#undef SNAPSHOT_ROW_SIZE
+#undef ROW_SIZE
+#undef ALIGN
@@ -0,0 +1,64 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+
+#include "settings.h"
+#include "scheduler.h"
+
+#define NS_PER_SECOND 1000000000ull
+#define FRAME_NS (NS_PER_SECOND / (TIMER_FREQUENCY))
+// if we fall further behind than this, give up on catching up.
+#define MAX_LAG_NS (4 * FRAME_NS)
+
+uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * NS_PER_SECOND + (uint64_t) now.tv_nsec;
+}
+
+void init_scheduler(struct scheduler* scheduler, uint32_t frequency) {
+    scheduler->frequency = frequency;
+    scheduler->leftover = 0;
+    scheduler->deadline = monotonic_ns() + FRAME_NS;
+}
+
+void set_cycles_per_frame(struct scheduler* scheduler, uint32_t cycles) {
+    scheduler->frequency = cycles * TIMER_FREQUENCY;
+    scheduler->leftover = 0;
+}
+
+/**
+ * How many instructions to run this frame.
+ * FREQUENCY need not divide evenly by TIMER_FREQUENCY (500 / 60 does not),
+ * so the remainder is carried over and the average comes out exact.
+ **/
+uint32_t next_batch(struct scheduler* scheduler) {
+    uint32_t total = scheduler->frequency + scheduler->leftover;
+    scheduler->leftover = total % TIMER_FREQUENCY;
+    return total / TIMER_FREQUENCY;
+}
+
+/**
+ * Sleeps until the end of the current frame and moves the deadline along.
+ * Deadlines advance by exactly one frame so that oversleeping in one frame
+ * is made up in the next; after a long stall (e.g. the window was dragged)
+ * the schedule restarts from now instead of racing to catch up.
+ **/
+void wait_for_frame(struct scheduler* scheduler) {
+    uint64_t now = monotonic_ns();
+    if(now < scheduler->deadline) {
+        uint64_t remaining = scheduler->deadline - now;
+        struct timespec request = {
+            .tv_sec = remaining / NS_PER_SECOND,
+            .tv_nsec = remaining % NS_PER_SECOND
+        };
+        while(nanosleep(&request, &request) != 0 && errno == EINTR);
+    } else if(now - scheduler->deadline > MAX_LAG_NS) {
+        scheduler->deadline = now;
+    }
+    scheduler->deadline += FRAME_NS;
+}
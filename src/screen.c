@@ -1,16 +1,16 @@
 /**
  * Author: Henry Jochaniewicz
- * Date modified: 01/02/26
+ * Date modified: 10/17/26
  **/
 #include <SDL3/SDL.h>
 #include <SDL3/SDL_keyboard.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 #include <time.h>
 
 #include "screen.h"
-#include "interpret.h"
-#include "debug.h"
+#include "platform.h"
 
 #define FACTOR 10
 
@@ -47,34 +47,92 @@ static SDL_Scancode codes[] = {
     SDL_SCANCODE_V  // F.
 };
 
+/**
+ * A gamepad plays the keys under the left hand: the d-pad is w a s d,
+ * i.e. 5 7 8 9, and the left and bottom face buttons are q and e.
+ **/
+static const struct {
+    SDL_GamepadButton button;
+    uint8_t key;
+} buttons[] = {
+    {SDL_GAMEPAD_BUTTON_DPAD_UP, 0x5},
+    {SDL_GAMEPAD_BUTTON_DPAD_LEFT, 0x7},
+    {SDL_GAMEPAD_BUTTON_DPAD_DOWN, 0x8},
+    {SDL_GAMEPAD_BUTTON_DPAD_RIGHT, 0x9},
+    {SDL_GAMEPAD_BUTTON_WEST, 0x4},
+    {SDL_GAMEPAD_BUTTON_SOUTH, 0x6}
+};
+
+static bool is_keypad(SDL_Scancode code) {
+    for(uint8_t i = 0; i <= 0xF; i++) {
+        if(codes[i] == code) return true;
+    }
+    return false;
+}
+
 /**
  * Callback to generate frequency for sound sampling.
+ * SDL holds the stream's lock while this runs, see play_sound().
  * @param   additional_amount   how much audio stream needs than what is queued currently
  * @param   total_amount        how much data audio stream eating atm
  **/
 void SDLCALL callback(void* userdata, SDL_AudioStream* stream, 
         int additional_amount, int total_amount) {
     // unused parameters, done to suppress warnings.
-    (void) userdata, (void) total_amount;
-    static uint32_t current_sample = 0;
+    (void) total_amount;
+    struct screen* screen = userdata;
     additional_amount /= sizeof(float);
 #define SAMPLE_SIZE 128
     while(additional_amount > 0) {
         float samples[SAMPLE_SIZE];
         const int total = additional_amount < SAMPLE_SIZE ? additional_amount : SAMPLE_SIZE;
-        for(int i = 0; i < total; i++) {
-            const float phase = current_sample * SOUND_FREQUENCY / 8000.0f;
-            samples[i] = SDL_sinf(phase * 2 * SDL_PI_F);
-            current_sample++;
-        }
-        current_sample %= 8000;
+        render_audio(&screen->audio, samples, total);
         SDL_PutAudioStreamData(stream, samples, total * sizeof(float));
         additional_amount -= total;
     }
+#undef SAMPLE_SIZE
+}
+
+/**
+ * Puts the texture on screen. Scaling up to the window is left to the GPU
+ * through the logical presentation set in init_screen().
+ **/
+static void present_display(struct screen* screen) {
+    if(!SDL_RenderClear(screen->renderer) ||
+            !SDL_RenderTexture(screen->renderer, screen->shown, NULL, NULL) ||
+            !SDL_RenderPresent(screen->renderer)) {
+        fprintf(stderr, "FAILURE: %s\n", SDL_GetError());
+    }
+}
+
+/**
+ * Expands the packed display into the streaming texture in one pass,
+ * then presents it with a single draw call.
+ * Only called when the display actually changed since the last frame.
+ * Each resolution has a texture of its own, so as not to expand four times
+ * the pixels for a lo-res game.
+ **/
+void draw_display(struct screen* screen, const struct display* display) {
+    screen->shown = display->hires ? screen->hires_texture : screen->texture;
+    void* pixels;
+    int pitch;
+    if(!SDL_LockTexture(screen->shown, NULL, &pixels, &pitch)) {
+        fprintf(stderr, "FAILURE: %s\n", SDL_GetError());
+        return;
+    }
+
+    expand_display(display, pixels, pitch);
+    SDL_UnlockTexture(screen->shown);
+
+    present_display(screen);
+    if(screen->latency != NULL) note_present(screen->latency);
 }
 
 bool init_screen(struct screen* screen) {
-    if(!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO)) {
+    for(uint8_t i = 0; i <= 0xF; i++) {
+        screen->keymap[i] = i;
+    }
+    if(!SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMEPAD)) {
         fprintf(stderr, "Failed to initialize SDL: %s\n", SDL_GetError());
         return false;
     }
@@ -85,117 +143,160 @@ bool init_screen(struct screen* screen) {
         return false;
     }
 
-    if(!SDL_SetRenderLogicalPresentation(screen->renderer, WIDTH, HEIGHT, 
+    // the hi-res size, so its pixels are not scaled down and back up.
+    if(!SDL_SetRenderLogicalPresentation(screen->renderer, HIRES_WIDTH, HIRES_HEIGHT, 
                 SDL_LOGICAL_PRESENTATION_LETTERBOX)) {
         fprintf(stderr, "FAILURE: %s\n", SDL_GetError());
     }
 
+    screen->texture = SDL_CreateTexture(screen->renderer, SDL_PIXELFORMAT_XRGB8888,
+            SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
+    screen->hires_texture = SDL_CreateTexture(screen->renderer, SDL_PIXELFORMAT_XRGB8888,
+            SDL_TEXTUREACCESS_STREAMING, HIRES_WIDTH, HIRES_HEIGHT);
+    if(screen->texture == NULL || screen->hires_texture == NULL) {
+        fprintf(stderr, "Failed to create texture: %s\n", SDL_GetError());
+        return false;
+    }
+    // keep pixels square and sharp when scaled up.
+    SDL_SetTextureScaleMode(screen->texture, SDL_SCALEMODE_NEAREST);
+    SDL_SetTextureScaleMode(screen->hires_texture, SDL_SCALEMODE_NEAREST);
+    // fast-forward shows no more frames than the display can.
+    const SDL_DisplayMode* mode = SDL_GetCurrentDisplayMode(SDL_GetDisplayForWindow(screen->window));
+    float refresh_rate = mode != NULL && mode->refresh_rate > 0 ? mode->refresh_rate : TIMER_FREQUENCY;
+    screen->refresh_ns = 1e9 / refresh_rate;
+    // letterbox bars are cleared to the background color.
+    SDL_SetRenderDrawColor(screen->renderer, (OFF_COLOR >> 16) & 0xFF,
+            (OFF_COLOR >> 8) & 0xFF, OFF_COLOR & 0xFF, SDL_ALPHA_OPAQUE);
+
+    // the interpreter only draws when the display changes, so start blank.
+    static const struct display blank;
+    draw_display(screen, &blank);
+
     SDL_AudioSpec spec = {
         .format = SDL_AUDIO_F32,
         .channels = 1,
-        .freq = 8000
+        .freq = SAMPLE_RATE
     };
 
+    init_audio(&screen->audio);
     screen->stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK,
-            &spec, callback, NULL);
+            &spec, callback, screen);
 
     if(screen->stream == NULL) {
         fprintf(stderr, "Failure in generating audio device: %s\n", SDL_GetError());
         return false;
     }
+    // it plays silence whenever the sound timer is out, so it never pauses.
+    SDL_ResumeAudioStreamDevice(screen->stream);
 
     return true;
 }
 
-bool handle_event(void) {
+bool handle_event(struct screen* screen) {
     SDL_Event event;
     while(SDL_PollEvent(&event)) {
         switch(event.type) {
             case SDL_EVENT_QUIT:
                 return false;
+            // the window lost its contents, but the texture still has them.
+            case SDL_EVENT_WINDOW_EXPOSED:
+            case SDL_EVENT_WINDOW_RESIZED:
+                present_display(screen);
+                break;
+            // the first gamepad plugged in is the one used.
+            case SDL_EVENT_GAMEPAD_ADDED:
+                if(screen->gamepad == NULL) {
+                    screen->gamepad = SDL_OpenGamepad(event.gdevice.which);
+                }
+                break;
+            case SDL_EVENT_GAMEPAD_REMOVED:
+                if(screen->gamepad != NULL &&
+                        SDL_GetGamepadID(screen->gamepad) == event.gdevice.which) {
+                    SDL_CloseGamepad(screen->gamepad);
+                    screen->gamepad = NULL;
+                }
+                break;
             case SDL_EVENT_KEY_DOWN:
                 if(event.key.key == SDLK_ESCAPE) {
                     return false;
                 }
+                // fall through.
+            case SDL_EVENT_KEY_UP:
+                if(screen->latency != NULL && !event.key.repeat && is_keypad(event.key.scancode)) {
+                    note_key_event(screen->latency, SDL_GetTicksNS() - event.key.timestamp);
+                }
+                break;
         }
     }
 
-    return true;
-}
-
-bool is_key_pressed(uint8_t num) {
-    if(num > 0xF) return false;
-    SDL_Scancode code = codes[num];
     int length = 0;
-    const bool* keys = SDL_GetKeyboardState(&length);
-    return keys[code];
+    const bool* keyboard = SDL_GetKeyboardState(&length);
+    screen->rewinding = keyboard[SDL_SCANCODE_BACKSPACE];
+    screen->fast_forwarding = keyboard[SDL_SCANCODE_TAB];
+    return true;
 }
 
-// Returns 0xFF on failure.
-uint8_t any_key_pressed(void) {
+// the keyboard and gamepad together, as a keypad mask.
+uint16_t read_keys(struct screen* screen) {
     int length = 0;
-    const bool* keys = SDL_GetKeyboardState(&length);
+    const bool* state = SDL_GetKeyboardState(&length);
+    uint16_t keys = 0;
     for(uint8_t i = 0; i <= 0xF; i++) {
-        if(keys[codes[i]]) return i;
-    }
-    return 0xFF;
-}
-
-void draw_display(SDL_Renderer* renderer, bool display[][WIDTH]) {
-#define BYTE_1(color) (((color) >> 16)& 0x0000FF)
-#define BYTE_2(color) (((color) >> 8) & 0x0000FF)
-#define BYTE_3(color) ((color) & 0x0000FF)
-    SDL_SetRenderDrawColor(renderer, BYTE_1(OFF_COLOR), 
-            BYTE_2(OFF_COLOR), BYTE_3(OFF_COLOR), SDL_ALPHA_OPAQUE);
-    SDL_RenderClear(renderer);
-
-    if(!SDL_SetRenderDrawColor(renderer, BYTE_1(ON_COLOR), 
-                BYTE_2(ON_COLOR), BYTE_3(ON_COLOR), SDL_ALPHA_OPAQUE)) {
-        fprintf(stdout, "FAILURE: %s\n", SDL_GetError());
+        keys |= (uint16_t) state[codes[i]] << screen->keymap[i];
     }
-    SDL_FRect r = {0};
-    r.w = 1;
-    r.h = 1;
-
-    for(uint32_t i = 0; i < HEIGHT; i++) {
-        for(uint32_t j = 0; j < WIDTH; j++) {
-            if(!display[i][j]) continue;
-            r.x = (float) j;
-            r.y = (float) i;
-            if(!SDL_RenderFillRect(renderer, &r)) {
-                fprintf(stderr, "FAILURE: %s\n", SDL_GetError());
-            }
+    if(screen->gamepad != NULL) {
+        for(size_t i = 0; i < sizeof(buttons) / sizeof(buttons[0]); i++) {
+            keys |= (uint16_t) SDL_GetGamepadButton(screen->gamepad, buttons[i].button) <<
+                screen->keymap[buttons[i].key];
         }
     }
-    
-    if(!SDL_RenderPresent(renderer)) {
-        fprintf(stderr, "FAILURE: %s\n", SDL_GetError());
-    }
-#undef BYTE_1
-#undef BYTE_2
-#undef BYTE_3
-}
-
-void clear_display(bool display[][WIDTH]) {
-    memset(display, false, HEIGHT * WIDTH);
+    return keys;
 }
 
 void destroy_screen(struct screen* screen) {
+    if(screen->gamepad != NULL) SDL_CloseGamepad(screen->gamepad);
+    SDL_DestroyTexture(screen->hires_texture);
+    SDL_DestroyTexture(screen->texture);
     SDL_DestroyRenderer(screen->renderer);
     SDL_DestroyWindow(screen->window);
     SDL_DestroyAudioStream(screen->stream);
     SDL_Quit();
 }
 
-void play_sound(SDL_AudioStream* stream, uint8_t timer_value) {
-    static bool is_playing = false;
+void play_sound(struct screen* screen, uint8_t timer_value, const struct sound_pattern* pattern) {
+    SDL_LockAudioStream(screen->stream);
+    set_audio(&screen->audio, timer_value, pattern);
+    SDL_UnlockAudioStream(screen->stream);
+}
+
 
-    if(timer_value == 0 && is_playing) {
-        is_playing = false;
-        SDL_PauseAudioStreamDevice(stream);
-    } else if(timer_value != 0 && !is_playing) {
-        is_playing = true;
-        SDL_ResumeAudioStreamDevice(stream);
-    }
+/**
+ * The platform callbacks below just unwrap the screen from `userdata`
+ * and forward to the functions above.
+ **/
+static bool screen_handle_events(void* userdata) {
+    return handle_event(userdata);
+}
+
+static uint16_t screen_read_keys(void* userdata) {
+    return read_keys(userdata);
+}
+
+static void screen_draw_display(void* userdata, const struct display* display) {
+    draw_display(userdata, display);
 }
 
+static void screen_play_sound(void* userdata, uint8_t timer_value,
+        const struct sound_pattern* pattern) {
+    play_sound(userdata, timer_value, pattern);
+}
+
+struct platform screen_platform(struct screen* screen) {
+    return (struct platform) {
+        .userdata = screen,
+        .handle_events = screen_handle_events,
+        .read_keys = screen_read_keys,
+        .draw_display = screen_draw_display,
+        .play_sound = screen_play_sound
+    };
+}
@@ -0,0 +1,91 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "settings.h"
+#include "platform.h"
+#include "script.h"
+
+// applies every event that is due by the current frame.
+static void apply_events(struct script* script) {
+    while(script->next < script->count &&
+            script->events[script->next].frame <= script->frame) {
+        script->keys = script->events[script->next++].keys;
+    }
+}
+
+bool load_script(struct script* script, const char* filename) {
+    *script = (struct script) {0};
+
+    FILE* fp = fopen(filename, "r");
+    if(fp == NULL) {
+        fprintf(stderr, "Failure in reading '%s'\n", filename);
+        return false;
+    }
+
+    char line[256];
+    size_t capacity = 0;
+    uint32_t line_number = 0;
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        line_number++;
+        unsigned long long frame;
+        unsigned int keys;
+        char first;
+        if(sscanf(line, " %c", &first) != 1 || first == '#') continue;
+        if(sscanf(line, "%llu %x", &frame, &keys) != 2 || keys > 0xFFFF ||
+                (script->count > 0 && frame < script->events[script->count - 1].frame)) {
+            fprintf(stderr, "%s:%u: expected '<frame> <keys>' in frame order\n",
+                    filename, line_number);
+            fclose(fp);
+            free_script(script);
+            return false;
+        }
+
+        if(script->count == capacity) {
+            capacity = capacity == 0 ? 64 : capacity * 2;
+            struct script_event* events = realloc(script->events, capacity * sizeof(*events));
+            if(events == NULL) {
+                fprintf(stderr, "Out of memory reading '%s'\n", filename);
+                fclose(fp);
+                free_script(script);
+                return false;
+            }
+            script->events = events;
+        }
+        script->events[script->count++] = (struct script_event) {frame, keys};
+    }
+    fclose(fp);
+
+    apply_events(script);
+    return true;
+}
+
+void free_script(struct script* script) {
+    free(script->events);
+    *script = (struct script) {0};
+}
+
+// called once per frame, so this is where the script moves on.
+static bool script_handle_events(void* userdata) {
+    struct script* script = userdata;
+    script->frame++;
+    apply_events(script);
+    return true;
+}
+
+static uint16_t script_read_keys(void* userdata) {
+    return ((const struct script*) userdata)->keys;
+}
+
+struct platform script_platform(struct script* script) {
+    struct platform platform = headless_platform;
+    platform.userdata = script;
+    platform.handle_events = script_handle_events;
+    platform.read_keys = script_read_keys;
+    return platform;
+}
@@ -0,0 +1,144 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "trace.h"
+
+#define FLUSH_NS 100000000 // how often the flusher wakes.
+
+#ifdef MAP_POPULATE
+#define MAP_FLAGS (MAP_SHARED | MAP_POPULATE) // so the emulator doesn't fault pages in.
+#else
+#define MAP_FLAGS MAP_SHARED
+#endif
+
+// msync() wants a page-aligned start.
+static void sync_range(const void* start, const void* end) {
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t) start & ~(page - 1);
+    if(msync((void*) first, (uintptr_t) end - first, MS_SYNC) != 0) {
+        perror("Failure in writing out the trace");
+    }
+}
+
+// writes out the records added since record `from`, and returns how far that is.
+static uint64_t flush_records(struct trace* trace, uint64_t from) {
+    uint64_t head = __atomic_load_n(&trace->header->head, __ATOMIC_ACQUIRE);
+    if(head == from) return head;
+    uint64_t capacity = trace->mask + 1;
+    uint64_t start = from & trace->mask;
+    uint64_t end = head & trace->mask;
+    if(head - from >= capacity) {
+        sync_range(trace->records, trace->records + capacity);
+    } else if(start < end) {
+        sync_range(trace->records + start, trace->records + end);
+    } else {
+        sync_range(trace->records + start, trace->records + capacity);
+        sync_range(trace->records, trace->records + end);
+    }
+    sync_range(trace->header, trace->header + 1);
+    return head;
+}
+
+static void* flush(void* argument) {
+    struct trace* trace = argument;
+    uint64_t flushed = 0;
+    pthread_mutex_lock(&trace->lock);
+    while(!trace->stopping) {
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += FLUSH_NS;
+        if(until.tv_nsec >= 1000000000) {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000;
+        }
+        pthread_cond_timedwait(&trace->wake, &trace->lock, &until);
+
+        pthread_mutex_unlock(&trace->lock);
+        flushed = flush_records(trace, flushed);
+        pthread_mutex_lock(&trace->lock);
+    }
+    pthread_mutex_unlock(&trace->lock);
+    return NULL;
+}
+
+bool open_trace(struct trace* trace, const char* filename, uint64_t capacity) {
+    *trace = (struct trace) {.fd = -1};
+    uint64_t rounded = 1;
+    while(rounded < capacity) rounded <<= 1;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t offset = (size_t) page > sizeof(struct trace_header) ? (size_t) page :
+        sizeof(struct trace_header);
+
+    trace->fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(trace->fd < 0) {
+        fprintf(stderr, "Failure in opening '%s' for the trace\n", filename);
+        return false;
+    }
+    trace->size = offset + rounded * sizeof(struct trace_record);
+    if(ftruncate(trace->fd, trace->size) != 0 ||
+            (trace->map = mmap(NULL, trace->size, PROT_READ | PROT_WRITE, MAP_FLAGS,
+                               trace->fd, 0)) == MAP_FAILED) {
+        fprintf(stderr, "Failure in mapping '%s' for the trace\n", filename);
+        close(trace->fd);
+        *trace = (struct trace) {.fd = -1};
+        return false;
+    }
+
+    trace->header = (struct trace_header*) trace->map;
+    trace->records = (struct trace_record*) (trace->map + offset);
+    trace->mask = rounded - 1;
+    memcpy(trace->header->magic, TRACE_MAGIC, sizeof(trace->header->magic));
+    trace->header->version = TRACE_VERSION;
+    trace->header->record_size = sizeof(struct trace_record);
+    trace->header->records_offset = offset;
+    trace->header->capacity = rounded;
+    trace->header->head = 0;
+
+    pthread_mutex_init(&trace->lock, NULL);
+    pthread_cond_init(&trace->wake, NULL);
+    if(pthread_create(&trace->flusher, NULL, flush, trace) != 0) {
+        fprintf(stderr, "Failure in starting the trace flusher\n");
+        pthread_cond_destroy(&trace->wake);
+        pthread_mutex_destroy(&trace->lock);
+        munmap(trace->map, trace->size);
+        close(trace->fd);
+        *trace = (struct trace) {.fd = -1};
+        return false;
+    }
+    return true;
+}
+
+void publish_trace(struct trace* trace) {
+    __atomic_store_n(&trace->header->head, trace->head, __ATOMIC_RELEASE);
+}
+
+void close_trace(struct trace* trace) {
+    if(trace->map == NULL) return;
+    publish_trace(trace);
+    pthread_mutex_lock(&trace->lock);
+    trace->stopping = true;
+    pthread_cond_signal(&trace->wake);
+    pthread_mutex_unlock(&trace->lock);
+    pthread_join(trace->flusher, NULL);
+
+    sync_range(trace->map, trace->map + trace->size);
+    pthread_cond_destroy(&trace->wake);
+    pthread_mutex_destroy(&trace->lock);
+    munmap(trace->map, trace->size);
+    close(trace->fd);
+    *trace = (struct trace) {.fd = -1};
+}
+
+#undef MAP_FLAGS
+#undef FLUSH_NS
@@ -0,0 +1,216 @@
+/**
+ * Author: Henry Jochaniewicz
+ * Date modified: 10/17/26
+ **/
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "memory.h"
+#include "trace.h"
+
+/**
+ * Reads what `chip8 --trace` writes, oldest record first, and prints the
+ * records that pass every filter given, or with --summary, totals for them.
+ * Can be run on a trace that is still being written.
+ *
+ * Usage: ./chip8-trace [filters] [--summary] FILE
+ *   --pc ADDRESS[-ADDRESS]    only instructions at these addresses.
+ *   --op PATTERN              only instructions matching PATTERN, e.g. DXYN or 8XY4:
+ *                             hex digits have to match, anything else matches any.
+ *   --register X              only instructions that changed VX.
+ *   --from CYCLE, --to CYCLE  only instructions run in this range of cycles.
+ **/
+
+#define HOTTEST 10
+
+struct filter {
+    uint16_t low_pc;
+    uint16_t high_pc;
+    uint16_t op_mask;
+    uint16_t op_value;
+    int changed; // -1 for any.
+    uint64_t from;
+    uint64_t to;
+};
+
+static void usage(FILE* fp) {
+    fprintf(fp, "Usage: ./chip8-trace [--pc ADDRESS[-ADDRESS]] [--op PATTERN] [--register X] "
+            "[--from CYCLE] [--to CYCLE] [--summary] <trace>\n");
+}
+
+static bool parse_pattern(const char* pattern, struct filter* filter) {
+    if(strlen(pattern) != 4) return false;
+    for(int i = 0; i < 4; i++) {
+        char digit[2] = {pattern[i], '\0'};
+        char* end;
+        unsigned long value = strtoul(digit, &end, 16);
+        if(*end != '\0') continue;
+        filter->op_mask |= 0xF << (12 - 4 * i);
+        filter->op_value |= value << (12 - 4 * i);
+    }
+    return true;
+}
+
+static bool matches(const struct filter* filter, const struct trace_record* record) {
+    return record->program_counter >= filter->low_pc &&
+        record->program_counter <= filter->high_pc &&
+        (record->instruction & filter->op_mask) == filter->op_value &&
+        (filter->changed < 0 || record->changed == filter->changed) &&
+        record->cycle >= filter->from && record->cycle <= filter->to;
+}
+
+static void print_record(const struct trace_record* record) {
+    printf("%12llu %03X %04X I=%03X", (unsigned long long) record->cycle,
+            record->program_counter, record->instruction, record->index_register);
+    if(record->changed != TRACE_NO_REGISTER) {
+        printf(" V%X=%02X", record->changed, record->value);
+    }
+    printf("\n");
+}
+
+struct summary {
+    uint64_t count;
+    uint64_t first;
+    uint64_t last;
+    uint64_t families[16]; // by the first hex digit of the instruction.
+    uint64_t changed[16];
+    uint64_t addresses[MEMORY_SIZE];
+};
+
+static void add_to_summary(struct summary* summary, const struct trace_record* record) {
+    if(summary->count++ == 0) summary->first = record->cycle;
+    summary->last = record->cycle;
+    summary->families[record->instruction >> 12]++;
+    if(record->changed != TRACE_NO_REGISTER) summary->changed[record->changed & 0xF]++;
+    summary->addresses[record->program_counter & (MEMORY_SIZE - 1)]++;
+}
+
+static void print_summary(const struct summary* summary) {
+    printf("%llu instructions", (unsigned long long) summary->count);
+    if(summary->count == 0) {
+        printf("\n");
+        return;
+    }
+    printf(", cycles %llu to %llu\n", (unsigned long long) summary->first,
+            (unsigned long long) summary->last);
+
+    printf("\nBy first digit:\n");
+    for(int i = 0; i < 16; i++) {
+        if(summary->families[i] == 0) continue;
+        printf("\t%XNNN %12llu %5.1f%%\n", i, (unsigned long long) summary->families[i],
+                100.0 * summary->families[i] / summary->count);
+    }
+
+    printf("\nRegisters changed:\n");
+    for(int i = 0; i < 16; i++) {
+        if(summary->changed[i] == 0) continue;
+        printf("\tV%X %12llu\n", i, (unsigned long long) summary->changed[i]);
+    }
+
+    // the hottest by selection, as in the profiler.
+    printf("\nHottest addresses:\n");
+    uint64_t previous = UINT64_MAX;
+    uint32_t previous_address = 0;
+    for(int i = 0; i < HOTTEST; i++) {
+        uint64_t best = 0;
+        uint32_t best_address = 0;
+        for(uint32_t address = 0; address < MEMORY_SIZE; address++) {
+            uint64_t count = summary->addresses[address];
+            bool listed = count > previous || (count == previous && address <= previous_address);
+            if(!listed && count > best) {
+                best = count;
+                best_address = address;
+            }
+        }
+        if(best == 0) break;
+        printf("\t%03X %12llu %5.1f%%\n", best_address, (unsigned long long) best,
+                100.0 * best / summary->count);
+        previous = best;
+        previous_address = best_address;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    struct filter filter = {.high_pc = 0xFFFF, .changed = -1, .to = UINT64_MAX};
+    bool summarize = false;
+    const char* filename = NULL;
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--pc") == 0 && i + 1 < argc) {
+            char* end;
+            filter.low_pc = filter.high_pc = strtoul(argv[++i], &end, 16);
+            if(*end == '-') filter.high_pc = strtoul(end + 1, NULL, 16);
+        } else if(strcmp(argv[i], "--op") == 0 && i + 1 < argc) {
+            if(!parse_pattern(argv[++i], &filter)) {
+                fprintf(stderr, "A pattern is four characters, e.g. DXYN\n");
+                return EXIT_FAILURE;
+            }
+        } else if(strcmp(argv[i], "--register") == 0 && i + 1 < argc) {
+            filter.changed = strtoul(argv[++i], NULL, 16) & 0xF;
+        } else if(strcmp(argv[i], "--from") == 0 && i + 1 < argc) {
+            filter.from = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--to") == 0 && i + 1 < argc) {
+            filter.to = strtoull(argv[++i], NULL, 10);
+        } else if(strcmp(argv[i], "--summary") == 0) {
+            summarize = true;
+        } else {
+            filename = argv[i];
+        }
+    }
+    if(filename == NULL) {
+        usage(stderr);
+        return EXIT_FAILURE;
+    }
+
+    int fd = open(filename, O_RDONLY);
+    struct stat status;
+    if(fd < 0 || fstat(fd, &status) != 0) {
+        fprintf(stderr, "Failure in opening '%s'\n", filename);
+        return EXIT_FAILURE;
+    }
+    size_t size = status.st_size;
+    const uint8_t* map = size >= sizeof(struct trace_header) ?
+        mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if(map == MAP_FAILED) {
+        fprintf(stderr, "'%s' is not a trace\n", filename);
+        return EXIT_FAILURE;
+    }
+
+    const struct trace_header* header = (const struct trace_header*) map;
+    if(memcmp(header->magic, TRACE_MAGIC, sizeof(header->magic)) != 0 ||
+            header->version != TRACE_VERSION ||
+            header->record_size != sizeof(struct trace_record) ||
+            header->capacity == 0 ||
+            header->records_offset + header->capacity * sizeof(struct trace_record) > size) {
+        fprintf(stderr, "'%s' is not a trace this can read\n", filename);
+        munmap((void*) map, size);
+        return EXIT_FAILURE;
+    }
+
+    const struct trace_record* records = (const struct trace_record*) (map + header->records_offset);
+    uint64_t head = __atomic_load_n(&header->head, __ATOMIC_ACQUIRE);
+    uint64_t first = head > header->capacity ? head - header->capacity : 0;
+    static struct summary summary;
+    for(uint64_t n = first; n < head; n++) {
+        const struct trace_record* record = &records[n & (header->capacity - 1)];
+        if(!matches(&filter, record)) continue;
+        if(summarize) {
+            add_to_summary(&summary, record);
+        } else {
+            print_record(record);
+        }
+    }
+    if(summarize) print_summary(&summary);
+
+    munmap((void*) map, size);
+    return EXIT_SUCCESS;
+}
+
+#undef HOTTEST